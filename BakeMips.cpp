@@ -0,0 +1,68 @@
+#include "Texture.h"
+
+#include <cstring>
+#include <iostream>
+
+/*
+Builds the mip chain of a TGA once, ahead of time, and saves it in the
+format Texture::TextureFromMipFile maps straight into memory, so loading it
+later takes no reading, copying or filtering:
+
+bakemips input.tga [output.srmip] [--texels linear|tiled]
+
+The output defaults to the input with its extension swapped for .srmip. The
+texels are saved linear, unless --texels tiled asks for them to be tiled.
+*/
+
+int main(int argc, char** argv) {
+	const char* input	= NULL;
+	const char* output	= NULL;
+	const char* texels	= NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--texels") && (i + 1) < argc) {
+			texels = argv[++i];
+		}
+		else if (!input) {
+			input = argv[i];
+		}
+		else if (!output) {
+			output = argv[i];
+		}
+		else {
+			std::cerr << "unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+	if (!input || (texels && strcmp(texels, "linear") && strcmp(texels, "tiled"))) {
+		std::cerr << "bakemips input.tga [output.srmip] [--texels linear|tiled]" << std::endl;
+		return 1;
+	}
+
+	string outName = output ? output : string(input);
+	if (!output) {
+		size_t dot = outName.find_last_of('.');
+		outName = outName.substr(0, (dot == string::npos) ? outName.size() : dot) + ".srmip";
+	}
+
+	Texture* t = Texture::TextureFromTGA(input);
+	if (!t->GetWidth()) {
+		delete t;
+		return 1;
+	}
+	if (texels) {
+		t->SetTexelLayout(strcmp(texels, "tiled") ? Texture::TEXELS_LINEAR : Texture::TEXELS_TILED);
+	}
+
+	if (!t->SaveMipFile(outName)) {
+		std::cerr << "couldn't write " << outName << std::endl;
+		delete t;
+		return 1;
+	}
+	std::cout << "baked " << t->GetWidth() << "x" << t->GetHeight()
+		<< ((t->GetTexelLayout() == Texture::TEXELS_TILED) ? " tiled" : " linear") << " texels into " << outName
+		<< " (" << (t->GetResidentBytes() >> 10) << "KB)" << std::endl;
+
+	delete t;
+	return 0;
+}
@@ -0,0 +1,395 @@
+#include "SoftwareRasteriser.h"
+
+#include "Mesh.h"
+#include "Texture.h"
+#include "TextureManager.h"
+#include "StreamingMesh.h"
+#include "MeshOptimiser.h"
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+
+/*
+Renders a fixed scene - the same sort of thing the demo draws, but always
+laid out the same way - for a number of frames, and reports how long each
+one took. Meant to be run headless, so results from different machines and
+builds can be compared:
+
+benchmark [--width W] [--height H] [--frames N] [--kernel scalar|sse2|sse4.2|avx2|avx512]
+	[--area] [--binning] [--threads N] [--no-hiz] [--no-guard-band] [--out frame.raw] [--trace trace.json]
+	[--weld] [--transform scalar|sse2|avx2] [--sample nearest|bilinear|mipmap_nearest|mipmap_bilinear]
+	[--texels linear|tiled] [--texture file.tga|file.srmip] [--mesh file.mesh|file.srmesh]
+	[--stream chunkVertices] [--optimise] [--meshlets]
+
+--stream draws the ship a chunk at a time through a StreamingMesh, so its
+--mesh has to be a .srmesh. --optimise runs it through MeshOptimiser, and
+--meshlets splits it into meshlets (after optimising it, if asked to).
+*/
+
+struct BenchmarkOptions {
+	uint		width;
+	uint		height;
+	int			frames;
+	const char*	kernel;
+	bool		area;
+	bool		binning;
+	uint		threads;
+	bool		hiZ;
+	bool		guardBand;
+	const char*	out;
+	const char*	trace;
+	bool		weld;
+	const char*	transform;
+	const char*	sample;
+	const char*	texels;
+	const char*	texture;
+	const char*	mesh;
+	uint		stream;	//vertices per chunk, or 0 to load the mesh whole
+	bool		optimise;
+	bool		meshlets;
+};
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions &o) {
+	o.width		= 1280;
+	o.height	= 960;
+	o.frames	= 100;
+	o.kernel	= NULL;
+	o.area		= false;
+	o.binning	= false;
+	o.threads	= 0;
+	o.hiZ		= true;
+	o.guardBand	= true;
+	o.out		= NULL;
+	o.trace		= NULL;
+	o.weld		= false;
+	o.transform	= NULL;
+	o.sample	= NULL;
+	o.texels	= NULL;
+	o.texture	= "snow_2_m_gold.tga";
+	o.mesh		= "spaceship.mesh";
+	o.stream	= 0;
+	o.optimise	= false;
+	o.meshlets	= false;
+
+	for (int i = 1; i < argc; ++i) {
+		bool hasValue = (i + 1) < argc;
+
+		if (!strcmp(argv[i], "--width") && hasValue) {
+			o.width = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--height") && hasValue) {
+			o.height = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--frames") && hasValue) {
+			o.frames = max(atoi(argv[++i]), 1);
+		}
+		else if (!strcmp(argv[i], "--kernel") && hasValue) {
+			o.kernel = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--area")) {
+			o.area = true;
+		}
+		else if (!strcmp(argv[i], "--binning")) {
+			o.binning = true;
+		}
+		else if (!strcmp(argv[i], "--threads") && hasValue) {
+			o.threads = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--no-hiz")) {
+			o.hiZ = false;
+		}
+		else if (!strcmp(argv[i], "--no-guard-band")) {
+			o.guardBand = false;
+		}
+		else if (!strcmp(argv[i], "--out") && hasValue) {
+			o.out = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--trace") && hasValue) {
+			o.trace = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--weld")) {
+			o.weld = true;
+		}
+		else if (!strcmp(argv[i], "--optimise")) {
+			o.optimise = true;
+		}
+		else if (!strcmp(argv[i], "--meshlets")) {
+			o.meshlets = true;
+		}
+		else if (!strcmp(argv[i], "--transform") && hasValue) {
+			o.transform = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--sample") && hasValue) {
+			o.sample = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--texture") && hasValue) {
+			o.texture = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--mesh") && hasValue) {
+			o.mesh = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--stream") && hasValue) {
+			o.stream = max(atoi(argv[++i]), 1);
+		}
+		else if (!strcmp(argv[i], "--texels") && hasValue && (!strcmp(argv[i + 1], "linear") || !strcmp(argv[i + 1], "tiled"))) {
+			o.texels = argv[++i];
+		}
+		else {
+			std::cout << "unknown option " << argv[i] << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool SetKernelByName(SoftwareRasteriser &r, const char* name) {
+	const PixelKernel::Type types[] = {
+		PixelKernel::KERNEL_SCALAR, PixelKernel::KERNEL_SSE2, PixelKernel::KERNEL_SSE42,
+		PixelKernel::KERNEL_AVX2, PixelKernel::KERNEL_AVX512
+	};
+
+	for (int i = 0; i < 5; ++i) {
+		PixelKernel k = PixelKernel::Create(types[i]);
+		if (k.type == types[i] && !strcmp(k.name, name)) {
+			r.SetPixelKernel(types[i]);
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool SetTransformByName(SoftwareRasteriser &r, const char* name) {
+	const VertexTransform::Type types[] = {
+		VertexTransform::TRANSFORM_SCALAR, VertexTransform::TRANSFORM_SSE2, VertexTransform::TRANSFORM_AVX2
+	};
+
+	for (int i = 0; i < 3; ++i) {
+		VertexTransform t = VertexTransform::Create(types[i]);
+		if (t.type == types[i] && !strcmp(t.name, name)) {
+			r.SetVertexTransform(types[i]);
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char* sampleNames[] = { "nearest", "bilinear", "mipmap_nearest", "mipmap_bilinear" };
+
+static bool SetSampleByName(SoftwareRasteriser &r, const char* name) {
+	for (int i = 0; i < 4; ++i) {
+		if (!strcmp(sampleNames[i], name)) {
+			r.SetSampleState((SoftwareRasteriser::SampleState)i);
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv) {
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	SoftwareRasteriser r(options.width, options.height);
+
+	if (options.kernel && !SetKernelByName(r, options.kernel)) {
+		std::cout << "kernel " << options.kernel << " isn't available here" << std::endl;
+		return 1;
+	}
+	if (options.transform && !SetTransformByName(r, options.transform)) {
+		std::cout << "vertex transform " << options.transform << " isn't available here" << std::endl;
+		return 1;
+	}
+	if (options.sample && !SetSampleByName(r, options.sample)) {
+		std::cout << "unknown sample state " << options.sample << std::endl;
+		return 1;
+	}
+	r.SetRasteriseMode(options.area ? SoftwareRasteriser::RASTERISE_AREA : SoftwareRasteriser::RASTERISE_EDGE);
+	r.SetThreadCount(options.threads);
+	r.SetBinning(options.binning);
+	r.SetHiZ(options.hiZ);
+	r.SetGuardBand(options.guardBand);
+
+	/*//////////////////////////////////////////////////////////
+	//**********	SCENE	************************************
+	*///////////////////////////////////////////////////////////
+
+	srand(1); // always the same scene
+
+	std::vector<Vector3> stars;
+	for (int i = 0; i < 1500; ++i) {
+		stars.push_back(Vector3((float)(rand() % 401 - 200), (float)(rand() % 401 - 200), (float)(rand() % 501 - 300)));
+	}
+
+	Colour sunColours[10];
+	sunColours[0] = Colour(255, 255, 0, 255);
+	for (int i = 1; i < 10; ++i) {
+		sunColours[i] = Colour(255, 0, 0, (i % 2) ? 10 : 0);
+	}
+
+	Mesh* starMesh		= Mesh::GeneratePoints(stars);
+	Mesh* sunMesh		= Mesh::GenerateSun(sunColours);
+	std::chrono::high_resolution_clock::time_point meshStart = std::chrono::high_resolution_clock::now();
+	Mesh* shipMesh		= Mesh::LoadMeshFile(options.mesh, options.weld);
+	std::chrono::duration<double, std::milli> meshTime = std::chrono::high_resolution_clock::now() - meshStart;
+	if (!shipMesh) {
+		std::cout << "couldn't load " << options.mesh << std::endl;
+		return 1;
+	}
+	if (options.optimise) {
+		MeshOptimiser::Optimise(shipMesh);
+	}
+	if (options.meshlets) {
+		if (!shipMesh->IsIndexed()) {
+			shipMesh->Weld();
+		}
+		MeshOptimiser::BuildMeshlets(shipMesh);
+	}
+	StreamingMesh* shipStream = NULL;
+	if (options.stream) {
+		shipStream = StreamingMesh::Open(options.mesh, options.stream);
+		if (!shipStream) {
+			std::cout << "couldn't stream " << options.mesh << std::endl;
+			return 1;
+		}
+	}
+	Mesh* rockMesh		= Mesh::GenerateRock();
+	Mesh* debrisMesh	= Mesh::GenerateDebris();
+	TextureManager textures;
+	std::chrono::high_resolution_clock::time_point loadStart = std::chrono::high_resolution_clock::now();
+	Texture* rockTex	= textures.Acquire(options.texture);
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - loadStart;
+	if (!rockTex->GetWidth()) {
+		std::cout << "couldn't load " << options.texture << std::endl;
+		return 1;
+	}
+
+	if (options.texels) {
+		rockTex->SetTexelLayout(strcmp(options.texels, "tiled") ? Texture::TEXELS_LINEAR : Texture::TEXELS_TILED);
+	}
+
+	std::vector<RenderObject> objects(8);
+
+	objects[0].mesh			= starMesh;
+	objects[0].modelMatrix	= Matrix4::Translation(Vector3(0, 0, -300));
+
+	objects[1].mesh			= sunMesh;
+	objects[1].modelMatrix	= Matrix4::Translation(Vector3(30, -10, -100)) * Matrix4::Scale(Vector3(20, 20, 20));
+
+	objects[2].mesh			= shipMesh;
+	objects[2].streamingMesh	= shipStream;
+	objects[2].modelMatrix	= Matrix4::Translation(Vector3(-2, 0, -15)) *
+		Matrix4::Rotation(90.0f, Vector3(1, 0, 0)) * Matrix4::Rotation(180.0f, Vector3(0, 1, 0));
+
+	const Vector3 rockPositions[] = { Vector3(10, 20, -60), Vector3(-10, -12, -40), Vector3(2, 2, -25) };
+	for (int i = 0; i < 3; ++i) {
+		objects[3 + i].mesh			= rockMesh;
+		objects[3 + i].texture		= rockTex;
+		objects[3 + i].modelMatrix	= Matrix4::Translation(rockPositions[i]);
+	}
+
+	objects[6].mesh			= debrisMesh;
+	objects[6].modelMatrix	= Matrix4::Translation(Vector3(1, 1, -30));
+
+	//a wall of rocks behind everything else, for plenty of overdraw
+	objects[7].mesh			= rockMesh;
+	objects[7].texture		= rockTex;
+	objects[7].modelMatrix	= Matrix4::Translation(Vector3(0, 0, -80)) * Matrix4::Scale(Vector3(8, 8, 8));
+
+	r.SetProjectionMatrix(Matrix4::Perspective(1.0f, 500.0f, (float)options.width / options.height, 45.0f));
+	r.SetViewMatrix(Matrix4());
+
+	/*//////////////////////////////////////////////////////////
+	//**********	RUN	****************************************
+	*///////////////////////////////////////////////////////////
+
+	const Colour* lastFrame = NULL;
+	uint frameWidth		= 0;
+	uint frameHeight	= 0;
+	r.SetFrameCallback([&](const Colour* pixels, uint width, uint height) {
+		lastFrame	= pixels;
+		frameWidth	= width;
+		frameHeight = height;
+	});
+
+	if (options.trace) {
+		r.StartTrace();
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for (int f = 0; f < options.frames; ++f) {
+		objects[2].modelMatrix = objects[2].modelMatrix * Matrix4::Rotation(-5.0f, Vector3(1, 0, 0));
+		objects[5].modelMatrix = objects[5].modelMatrix * Matrix4::Rotation(10.0f, Vector3(0, 0, 1));
+
+		r.ClearBuffers();
+		for (uint i = 0; i < objects.size(); ++i) {
+			r.DrawObject(&objects[i]);
+		}
+		r.SwapBuffers();
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	if (options.trace && !r.StopTrace(options.trace)) {
+		std::cout << "couldn't write the trace to " << options.trace << std::endl;
+	}
+
+	double msPerFrame	= elapsed.count() / options.frames;
+	double mPixels		= (double)options.width * options.height * options.frames / (elapsed.count() * 1000.0);
+
+	std::cout << "kernel " << r.GetPixelKernelName() << ", " << r.GetVertexTransformName() << " transform"
+		<< (options.area ? ", area fill" : ", edge fill")
+		<< (options.binning ? ", binned on " : ", ") << (options.binning ? r.GetThreadCount() : 1) << " thread(s)"
+		<< (options.hiZ ? ", hi-z" : "") << (options.guardBand ? ", guard band" : "")
+		<< ", " << sampleNames[r.GetSampleState()] << " sampling"
+		<< ((rockTex->GetTexelLayout() == Texture::TEXELS_TILED) ? ", tiled texels" : ", linear texels") << std::endl;
+	std::cout << options.frames << " frames at " << options.width << "x" << options.height << ": "
+		<< msPerFrame << " ms/frame, " << mPixels << " Mpixels/s" << std::endl;
+
+	if (PIPELINE_STATS_ENABLED) {
+		const PipelineStats &s = r.GetPipelineStats();
+		std::cout << "last frame: " << s.verticesTransformed << " vertices transformed, "
+			<< s.meshletsSubmitted << " meshlets submitted, " << s.meshletsFrustumCulled << " culled off screen, "
+			<< s.meshletsBackFacing << " back facing, "
+			<< s.trianglesSubmitted << " triangles submitted, " << s.trianglesTrivialAccepted << " trivially accepted, "
+			<< s.trianglesTrivialRejected << " trivially rejected, " << s.trianglesGuardBanded << " left to the guard band, "
+			<< s.trianglesClipped << " clipped, "
+			<< s.trianglesClipCulled << " clipped away, " << s.trianglesEmitted << " emitted, "
+			<< s.trianglesBackFacing << " back facing" << std::endl;
+		std::cout << "\t" << s.linesSubmitted << " lines (" << s.linesClipCulled << " clipped away), "
+			<< s.pointsSubmitted << " points, " << s.depthTestsPassed << " depth tests passed, "
+			<< s.depthTestsFailed << " failed, " << s.pixelsBlended << " pixels blended" << std::endl;
+	}
+	std::cout << "textures: " << textures.GetTextureCount() << " loaded in " << loadTime.count() << " ms, "
+		<< (textures.GetResidentBytes() >> 10) << "KB resident" << std::endl;
+	std::cout << "mesh: " << shipMesh->GetNumVertices() << " vertices loaded in " << meshTime.count() << " ms";
+	if (shipMesh->HasMeshlets()) {
+		std::cout << ", " << shipMesh->GetNumMeshlets() << " meshlets";
+	}
+	std::cout << std::endl;
+	if (shipStream) {
+		std::cout << "streamed in " << shipStream->GetChunkCount() << " chunks of " << shipStream->GetChunkVertices()
+			<< " vertices, " << (shipStream->GetResidentBytes() >> 10) << "KB resident"
+			<< (shipStream->IsGood() ? "" : ", with read errors") << std::endl;
+	}
+
+	if (options.out && lastFrame) {
+		std::ofstream file(options.out, std::ios::binary);
+		file.write((const char*)lastFrame, frameWidth * frameHeight * sizeof(Colour));
+	}
+
+	delete starMesh;
+	delete sunMesh;
+	delete shipMesh;
+	delete shipStream;
+	delete rockMesh;
+	delete debrisMesh;
+	textures.Release(rockTex);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "CPUFeatures.h"
+
+#ifdef SR_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+bool CPUFeatures::detected	= false;
+bool CPUFeatures::sse2		= false;
+bool CPUFeatures::sse42		= false;
+bool CPUFeatures::avx2		= false;
+bool CPUFeatures::avx512	= false;
+
+#ifdef SR_X86
+static void CPUID(int leaf, int subLeaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	__cpuidex((int*)regs, leaf, subLeaf);
+#else
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//which register states the OS saves on a context switch
+static unsigned long long XGetBV() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+void CPUFeatures::Detect() {
+	detected = true;
+#ifdef SR_X86
+	unsigned int regs[4];
+
+	CPUID(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+
+	CPUID(1, 0, regs);
+	sse2	= (regs[3] & (1 << 26)) != 0;
+	sse42	= (regs[2] & (1 << 20)) != 0;
+
+	bool osxsave	= (regs[2] & (1 << 27)) != 0;
+	bool avx		= (regs[2] & (1 << 28)) != 0;
+
+	//AVX state is only usable if the OS saves the upper halves of the ymm registers,
+	//and AVX-512 needs the zmm registers and mask registers saving too
+	unsigned long long xcr0 = osxsave ? XGetBV() : 0;
+	bool osYmm = (xcr0 & 0x6) == 0x6;
+	bool osZmm = (xcr0 & 0xE6) == 0xE6;
+
+	if (maxLeaf >= 7 && avx && osYmm) {
+		CPUID(7, 0, regs);
+		avx2	= (regs[1] & (1 << 5)) != 0;
+		avx512	= osZmm && (regs[1] & (1 << 16)) != 0;
+	}
+#endif
+}
+
+bool CPUFeatures::HasSSE2() {
+	if (!detected) {
+		Detect();
+	}
+	return sse2;
+}
+
+bool CPUFeatures::HasSSE42() {
+	if (!detected) {
+		Detect();
+	}
+	return sse42;
+}
+
+bool CPUFeatures::HasAVX2() {
+	if (!detected) {
+		Detect();
+	}
+	return avx2;
+}
+
+bool CPUFeatures::HasAVX512() {
+	if (!detected) {
+		Detect();
+	}
+	return avx512;
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+Class:CPUFeatures
+Implements:
+Author:Geoff Whitehead
+Description:Runtime detection of the SIMD instruction sets the processor (and
+the OS, for the wider registers) supports, so the rasteriser can pick its
+fastest code paths when it starts up rather than when it is compiled.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SR_X86 1
+#endif
+
+class CPUFeatures {
+public:
+	static bool	HasSSE2();
+	static bool	HasSSE42();
+	static bool	HasAVX2();
+	static bool	HasAVX512();	//just the foundation instructions
+
+protected:
+	static void	Detect();
+
+	static bool	detected;
+	static bool	sse2;
+	static bool	sse42;
+	static bool	avx2;
+	static bool	avx512;
+};
@@ -28,9 +28,38 @@ static inline double DegToRad(const double rad)	{
 	return rad * PI / 180.0;
 };
 
+//Which Window implementation to build. The headless one has no screen or
+//input devices, and can be asked for on Windows too by defining SR_HEADLESS.
+#if defined(_WIN32) && !defined(SR_HEADLESS)
+#define WINDOW_WIN32 1
+#else
+#define WINDOW_HEADLESS 1
+#endif
+
 //I blame Microsoft...
+#ifdef _MSC_VER
 #define max(a,b)    (((a) > (b)) ? (a) : (b))
 #define min(a,b)    (((a) < (b)) ? (a) : (b))
 #define clamp(a,b,c) (a < b ? b : (a > c ? c : a))
+#else
+//Other compilers' standard headers use these names themselves, so they can't
+//be macros there. These behave the same, mixed argument types and all.
+#include <type_traits>
+
+template <typename A, typename B>
+static inline typename std::common_type<A, B>::type max(A a, B b) {
+	return (a > b) ? a : b;
+}
+
+template <typename A, typename B>
+static inline typename std::common_type<A, B>::type min(A a, B b) {
+	return (a < b) ? a : b;
+}
+
+template <typename A, typename B, typename C>
+static inline typename std::common_type<A, B, C>::type clamp(A a, B b, C c) {
+	return a < b ? b : (a > c ? c : a);
+}
+#endif
 
 typedef unsigned int uint;
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "FrameTrace.h"
+
+#include <fstream>
+#include <iomanip>
+
+FrameTrace::FrameTrace(void) {
+	recording = false;
+	startTime = std::chrono::steady_clock::now();
+}
+
+void FrameTrace::Start() {
+	std::lock_guard<std::mutex> lock(mutex);
+	events.clear();
+	threads.clear();
+	startTime = std::chrono::steady_clock::now();
+	recording = true;
+}
+
+bool FrameTrace::Stop(const std::string &filename) {
+	std::lock_guard<std::mutex> lock(mutex);
+	recording = false;
+
+	std::ofstream file(filename.c_str());
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	for (uint i = 0; i < events.size(); ++i) {
+		const TraceEvent &e = events[i];
+		file << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+			<< "\",\"ph\":\"X\",\"ts\":" << e.start << ",\"dur\":" << e.duration
+			<< ",\"pid\":1,\"tid\":" << e.thread;
+		if (!e.args.empty()) {
+			file << ",\"args\":{" << e.args << "}";
+		}
+		file << "}" << ((i + 1) < events.size() ? ",\n" : "\n");
+	}
+	file << "]}\n";
+
+	events.clear();
+	threads.clear();
+	return file.good();
+}
+
+void FrameTrace::Add(const char* name, const char* category, double start, double end, const std::string &args) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!recording) {
+		return; //stopped while this was being timed
+	}
+	TraceEvent e;
+	e.name		= name;
+	e.category	= category;
+	e.start		= start;
+	e.duration	= end - start;
+	e.thread	= ThreadIndex(std::this_thread::get_id());
+	e.args		= args;
+	events.push_back(e);
+}
+
+//small numbers read better in the viewer than whatever the OS uses
+uint FrameTrace::ThreadIndex(std::thread::id id) {
+	for (uint i = 0; i < threads.size(); ++i) {
+		if (threads[i] == id) {
+			return i;
+		}
+	}
+	threads.push_back(id);
+	return (uint)threads.size() - 1;
+}
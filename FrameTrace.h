@@ -0,0 +1,100 @@
+/******************************************************************************
+Class:FrameTrace
+Implements:
+Author:Geoff Whitehead
+Description:Records when each stage of each frame started and how long it
+took, on whichever thread ran it, and writes them out as a Chrome trace -
+a JSON file chrome://tracing and ui.perfetto.dev can both open.
+
+Stages are timed by putting a TraceScope on the stack. While nothing is
+being recorded, a TraceScope costs a single check of a bool.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include "Common.h"
+
+struct TraceEvent {
+	const char*	name;
+	const char*	category;
+	double		start;		//microseconds since recording started
+	double		duration;	//microseconds
+	uint		thread;
+	std::string	args;		//the members of a JSON object, or empty
+};
+
+class FrameTrace {
+public:
+	FrameTrace(void);
+	~FrameTrace(void) {}
+
+	//Throws away anything recorded so far, and starts again
+	void	Start();
+	//Stops recording, and writes everything recorded out to filename
+	bool	Stop(const std::string &filename);
+
+	bool	IsRecording() const { return recording; }
+
+	//microseconds since recording started
+	double	Now() const {
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	//Safe to call from any thread
+	void	Add(const char* name, const char* category, double start, double end, const std::string &args);
+
+protected:
+	uint	ThreadIndex(std::thread::id id);
+
+	std::atomic<bool>					recording;
+	std::chrono::steady_clock::time_point	startTime;
+
+	std::mutex							mutex;
+	std::vector<TraceEvent>				events;
+	std::vector<std::thread::id>		threads;	//index in here is the trace's thread id
+};
+
+//Times everything from its construction until End, or until it goes out of
+//scope, if the trace was recording when it was made
+class TraceScope {
+public:
+	TraceScope(FrameTrace &t, const char* name, const char* category) {
+		trace = t.IsRecording() ? &t : NULL;
+		if (trace) {
+			this->name		= name;
+			this->category	= category;
+			start			= trace->Now();
+		}
+	}
+
+	~TraceScope(void) {
+		End();
+	}
+
+	bool	IsRecording() const { return trace != NULL; }
+
+	//only worth building if IsRecording
+	void	SetArgs(const std::string &a) { args = a; }
+
+	void	End() {
+		if (trace) {
+			trace->Add(name, category, start, trace->Now(), args);
+			trace = NULL;
+		}
+	}
+
+protected:
+	FrameTrace*	trace;
+	const char*	name;
+	const char*	category;
+	double		start;
+	std::string	args;
+};
@@ -0,0 +1,90 @@
+#include "HiZBuffer.h"
+
+HiZBuffer::HiZBuffer(void) {
+	depth	= NULL;
+	width	= 0;
+	height	= 0;
+	blocksX = blocksY = 0;
+	tilesX	= tilesY  = 0;
+}
+
+void HiZBuffer::Resize(uint w, uint h, const unsigned short* depthBuffer) {
+	depth	= depthBuffer;
+	width	= w;
+	height	= h;
+
+	blocksX = (width  + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	tilesX	= (width  + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY	= (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	blockMax.resize(blocksX * blocksY);
+	tileMax.resize(tilesX * tilesY);
+	blockDirty.resize(blocksX * blocksY);
+	tileDirty.resize(tilesX * tilesY);
+
+	Clear(0xFFFF);
+}
+
+void HiZBuffer::Clear(unsigned short d) {
+	std::fill(blockMax.begin(), blockMax.end(), d);
+	std::fill(tileMax.begin(), tileMax.end(), d);
+	std::fill(blockDirty.begin(), blockDirty.end(), 0);
+	std::fill(tileDirty.begin(), tileDirty.end(), 0);
+}
+
+unsigned short HiZBuffer::BlockMax(int x, int y) {
+	uint bx		= x >> BLOCK_SHIFT;
+	uint by		= y >> BLOCK_SHIFT;
+	uint index	= (by * blocksX) + bx;
+
+	if (blockDirty[index]) {
+		uint startX = bx * BLOCK_SIZE;
+		uint startY = by * BLOCK_SIZE;
+		uint endX	= min(startX + BLOCK_SIZE, width);
+		uint endY	= min(startY + BLOCK_SIZE, height);
+
+		unsigned short furthest = 0;
+		for (uint py = startY; py < endY; ++py) {
+			const unsigned short* row = &depth[py * width];
+			for (uint px = startX; px < endX; ++px) {
+				furthest = max(furthest, row[px]);
+			}
+		}
+		blockMax[index]		= furthest;
+		blockDirty[index]	= 0;
+	}
+	return blockMax[index];
+}
+
+unsigned short HiZBuffer::TileMax(int tx, int ty) {
+	uint index = (ty * tilesX) + tx;
+
+	if (tileDirty[index]) {
+		int startX	= tx * TILE_SIZE;
+		int startY	= ty * TILE_SIZE;
+		int endX	= min(startX + TILE_SIZE, (int)width);
+		int endY	= min(startY + TILE_SIZE, (int)height);
+
+		unsigned short furthest = 0;
+		for (int y = startY; y < endY; y += BLOCK_SIZE) {
+			for (int x = startX; x < endX; x += BLOCK_SIZE) {
+				furthest = max(furthest, BlockMax(x, y));
+			}
+		}
+		tileMax[index]		= furthest;
+		tileDirty[index]	= 0;
+	}
+	return tileMax[index];
+}
+
+unsigned short HiZBuffer::AreaMax(int minX, int minY, int maxX, int maxY) {
+	unsigned short furthest = 0;
+
+	for (int ty = minY >> TILE_SHIFT; ty <= (maxY >> TILE_SHIFT); ++ty) {
+		for (int tx = minX >> TILE_SHIFT; tx <= (maxX >> TILE_SHIFT); ++tx) {
+			furthest = max(furthest, TileMax(tx, ty));
+		}
+	}
+	return furthest;
+}
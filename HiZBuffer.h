@@ -0,0 +1,89 @@
+/******************************************************************************
+Class:HiZBuffer
+Implements:
+Author:Geoff Whitehead
+Description:A coarse copy of the depth buffer, holding the furthest depth
+written so far in every 8x8 block of pixels, and in every 64x64 tile of
+blocks. If the nearest point of a triangle is further away than that, every
+one of its pixels would fail the depth test, so the rasteriser can skip the
+whole block (or triangle) without looking at it.
+
+Depth only ever gets nearer between clears, so a stored maximum is never
+wrong, just sometimes further away than it could be. Blocks with new depth
+written into them are marked, and their maximum worked out again the next
+time it is asked for.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+
+//How much work the Hi-Z tests did, and how much they saved
+struct HiZStats {
+	uint	trianglesTested;
+	uint	trianglesCulled;
+	uint	blocksTested;
+	uint	blocksCulled;
+
+	HiZStats() {
+		Reset();
+	}
+
+	void Reset() {
+		trianglesTested = trianglesCulled = 0;
+		blocksTested	= blocksCulled	  = 0;
+	}
+
+	void Add(const HiZStats &s) {
+		trianglesTested += s.trianglesTested;
+		trianglesCulled += s.trianglesCulled;
+		blocksTested	+= s.blocksTested;
+		blocksCulled	+= s.blocksCulled;
+	}
+};
+
+class HiZBuffer {
+public:
+	static const int BLOCK_SHIFT	= 3;
+	static const int BLOCK_SIZE		= 1 << BLOCK_SHIFT;
+	static const int TILE_SHIFT		= 6;
+	static const int TILE_SIZE		= 1 << TILE_SHIFT;
+
+	HiZBuffer(void);
+	~HiZBuffer(void) {}
+
+	void	Resize(uint width, uint height, const unsigned short* depthBuffer);
+	void	Clear(unsigned short depth);
+
+	//Call whenever depth is written at x, y
+	inline void MarkWritten(int x, int y) {
+		blockDirty[((y >> BLOCK_SHIFT) * blocksX) + (x >> BLOCK_SHIFT)] = 1;
+		tileDirty[((y >> TILE_SHIFT) * tilesX) + (x >> TILE_SHIFT)]		= 1;
+	}
+
+	//Furthest depth in the block containing pixel x, y
+	unsigned short	BlockMax(int x, int y);
+	//Furthest depth in all of the tiles the box touches
+	unsigned short	AreaMax(int minX, int minY, int maxX, int maxY);
+
+protected:
+	unsigned short	TileMax(int tx, int ty);
+
+	const unsigned short*	depth;
+	uint					width;
+	uint					height;
+
+	uint					blocksX;
+	uint					blocksY;
+	uint					tilesX;
+	uint					tilesY;
+
+	std::vector<unsigned short>	blockMax;
+	std::vector<unsigned short>	tileMax;
+	std::vector<unsigned char>	blockDirty;
+	std::vector<unsigned char>	tileDirty;
+};
@@ -2,7 +2,9 @@
 Class:InputDevice
 Implements:
 Author:Rich Davison	<richard.davison4@newcastle.ac.uk>
-Description:Abstract base class for Windows RAW keyboard / mouse input
+Description:Abstract base class for Windows RAW keyboard / mouse input. In
+headless builds there's nothing to read input from, so devices just report
+that nothing is ever pressed.
 
 Input devices can be temporarily sent to sleep (so keyboard input doesn't work
 when the game is minimised etc), and obviously woken up again.
@@ -19,6 +21,9 @@ _-_-_-_-_-_-_-""  ""
 *//////////////////////////////////////////////////////////////////////////////
 
 #pragma once
+#include "Common.h"
+
+#ifdef WINDOW_WIN32
 #include<windows.h>
 
 /*
@@ -36,6 +41,7 @@ despite it being how RAW input works....GG guys.
 #ifndef HID_USAGE_GENERIC_KEYBOARD
 #define HID_USAGE_GENERIC_KEYBOARD		((USHORT) 0x06)
 #endif
+#endif
 
 class InputDevice	{
 protected:
@@ -44,12 +50,16 @@ protected:
 	~InputDevice(void){};
 
 protected:
+#ifdef WINDOW_WIN32
 	virtual void Update(RAWINPUT* raw) = 0;
+#endif
 
 	virtual void UpdateHolds() {}
 	virtual void Sleep(){ isAwake = false;}
 	virtual void Wake() { isAwake = true;}
 
 	bool			isAwake;		//Is the device awake...
+#ifdef WINDOW_WIN32
 	RAWINPUTDEVICE	rid;			//Windows OS hook 
+#endif
 };
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "Keyboard.h"
 
+#include <cstring>
+
 Keyboard* Keyboard::instance = 0;
 
+#ifdef WINDOW_WIN32
 Keyboard::Keyboard(HWND &hwnd)	{
 	//Initialise the arrays to false!
-	ZeroMemory(keyStates,  KEY_MAX * sizeof(bool));
-	ZeroMemory(holdStates, KEY_MAX * sizeof(bool));
+	memset(keyStates,  0, KEY_MAX * sizeof(bool));
+	memset(holdStates, 0, KEY_MAX * sizeof(bool));
 
 	//Tedious windows RAW input stuff
 	rid.usUsagePage		= HID_USAGE_PAGE_GENERIC;		//The keyboard isn't anything fancy
@@ -18,6 +21,16 @@ Keyboard::Keyboard(HWND &hwnd)	{
 void Keyboard::Initialise(HWND &hwnd) {
 	instance = new Keyboard(hwnd);
 }
+#else
+Keyboard::Keyboard()	{
+	memset(keyStates,  0, KEY_MAX * sizeof(bool));
+	memset(holdStates, 0, KEY_MAX * sizeof(bool));
+}
+
+void Keyboard::Initialise() {
+	instance = new Keyboard();
+}
+#endif
 
 void Keyboard::Destroy() {
 	delete instance;
@@ -40,8 +53,8 @@ keypresses until it receives a Wake()
 void Keyboard::Sleep()	{
 	isAwake = false;	//Night night!
 	//Prevents incorrectly thinking keys have been held / pressed when waking back up
-	ZeroMemory(instance->keyStates,  KEY_MAX * sizeof(bool));
-	ZeroMemory(instance->holdStates, KEY_MAX * sizeof(bool));
+	memset(instance->keyStates,  0, KEY_MAX * sizeof(bool));
+	memset(instance->holdStates, 0, KEY_MAX * sizeof(bool));
 }
 
 /*
@@ -71,6 +84,7 @@ bool Keyboard::KeyTriggered(KeyboardKeys key) {
 	return (instance->KeyDown(key) && !instance->KeyHeld(key));
 }
 
+#ifdef WINDOW_WIN32
 /*
 Updates the keyboard state with data received from the OS.
 */
@@ -86,4 +100,5 @@ void Keyboard::Update(RAWINPUT* raw)	{
 		//First bit of the flags tag determines whether the key is down or up
 		keyStates[key] = !(raw->data.keyboard.Flags & RI_KEY_BREAK);
 	}
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -181,16 +181,26 @@ public:
 	static bool KeyTriggered(KeyboardKeys key);
 
 protected:
+#ifdef WINDOW_WIN32
 	Keyboard(HWND &hwnd);
+#else
+	Keyboard();
+#endif
 	~Keyboard(void){}
 	//Update the holdStates array...call this each frame!
 	virtual void UpdateHolds();	
+#ifdef WINDOW_WIN32
 	//Update the keyStates array etc...call this each frame!
 	virtual void Update(RAWINPUT* raw);
+#endif
 	//Sends the keyboard to sleep
 	virtual void Sleep();
 
+#ifdef WINDOW_WIN32
 	static void Initialise(HWND &hwnd);
+#else
+	static void Initialise();
+#endif
 	static void Destroy();
 
 	static Keyboard* instance;
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+	data	= NULL;
+	size	= 0;
+#ifdef _WIN32
+	file	= INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+#ifdef _WIN32
+
+MappedFile* MappedFile::Open(const std::string &filename) {
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return NULL;
+	}
+
+	MappedFile* m	= new MappedFile();
+	m->data			= (const unsigned char*)view;
+	m->size			= (size_t)fileSize.QuadPart;
+	m->file			= file;
+	m->mapping		= mapping;
+	return m;
+}
+
+MappedFile::~MappedFile() {
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle((HANDLE)mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle((HANDLE)file);
+	}
+}
+
+#else
+
+MappedFile* MappedFile::Open(const std::string &filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file open itself
+	if (view == MAP_FAILED) {
+		return NULL;
+	}
+
+	MappedFile* m	= new MappedFile();
+	m->data			= (const unsigned char*)view;
+	m->size			= (size_t)info.st_size;
+	return m;
+}
+
+MappedFile::~MappedFile() {
+	if (data) {
+		munmap((void*)data, size);
+	}
+}
+
+#endif
@@ -0,0 +1,41 @@
+/******************************************************************************
+Class:MappedFile
+Implements:
+Author:Geoff Whitehead
+Description:A whole file mapped read only into memory, so loaders can use its
+contents where they lie instead of reading them into buffers of their own.
+Nothing is read from disk until it's touched, and untouched pages cost no
+memory at all.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+class MappedFile {
+public:
+	//NULL if the file can't be opened, or is empty
+	static MappedFile*	Open(const std::string &filename);
+
+	~MappedFile();
+
+	const unsigned char*	GetData() const { return data; }
+	size_t					GetSize() const { return size; }
+
+	bool	Contains(const void* p) const {
+		return (const unsigned char*)p >= data && (const unsigned char*)p < data + size;
+	}
+
+protected:
+	MappedFile();
+
+	const unsigned char*	data;
+	size_t					size;
+
+#ifdef _WIN32
+	void*	file;		//HANDLEs, kept out of the header so windows.h is too
+	void*	mapping;
+#endif
+};
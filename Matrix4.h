@@ -16,7 +16,8 @@ _-_-_-_-_-_-_-""  ""
 #pragma once
 
 #include <iostream>
-#include "common.h"
+#include <cstring>
+#include "Common.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
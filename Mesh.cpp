@@ -1,19 +1,185 @@
 #include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "OBJLoader.h"
+
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
 
 Mesh::Mesh(void)	{
 	type = PRIMITIVE_POINTS;
 
 	numVertices = 0;
 
+	numIndices	= 0;
+	indices16	= NULL;
+	indices32	= NULL;
+
 	vertices = NULL;
 	colours = NULL;
 	textureCoords = NULL;
+	opaque = true;
+
+	file = NULL;
 }
 
 Mesh::~Mesh(void)	{
-	delete[] vertices;
-	delete[] colours;
-	delete[] textureCoords;
+	FreeArray(vertices);
+	FreeArray(colours);
+	FreeArray(textureCoords);
+	ClearIndices();
+	delete file;
+}
+
+template <typename T>
+void Mesh::FreeArray(T* &a) {
+	if (!(file && file->Contains(a))) {
+		delete[] a;
+	}
+	a = NULL;
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	INDICES		********************************
+*///////////////////////////////////////////////////////////
+
+void Mesh::ClearIndices() {
+	FreeArray(indices16);
+	FreeArray(indices32);
+	numIndices	= 0;
+}
+
+void Mesh::SetIndices(const std::vector<uint> &indices) {
+	ClearIndices();
+	ClearMeshlets();
+
+	numIndices = (uint)indices.size();
+
+	if (numVertices <= 65536) {
+		indices16 = new unsigned short[numIndices];
+		for (uint i = 0; i < numIndices; ++i) {
+			indices16[i] = (unsigned short)indices[i];
+		}
+	}
+	else {
+		indices32 = new uint[numIndices];
+		for (uint i = 0; i < numIndices; ++i) {
+			indices32[i] = indices[i];
+		}
+	}
+}
+
+void Mesh::ClearMeshlets() {
+	std::vector<Meshlet>().swap(meshlets);
+	std::vector<unsigned char>().swap(meshletTriangles);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	IS OPAQUE	****************************
+*///////////////////////////////////////////////////////////
+
+void Mesh::UpdateOpaque() {
+	opaque = true;
+	for (uint i = 0; colours && i < numVertices; ++i) {
+		if (colours[i].a != 255) {
+			opaque = false;
+			break;
+		}
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	WELD	************************************
+*///////////////////////////////////////////////////////////
+
+//everything that has to match for two vertices to be merged, compared bit
+//for bit, so NaNs and -0 don't throw it
+struct WeldKey {
+	float	position[4];
+	uint	colour;
+	float	texCoord[2];
+
+	bool operator==(const WeldKey &k) const {
+		return memcmp(this, &k, sizeof(WeldKey)) == 0;
+	}
+};
+
+struct WeldKeyHash {
+	size_t operator()(const WeldKey &k) const {
+		const unsigned char* bytes = (const unsigned char*)&k;
+		size_t hash = 2166136261u; //FNV-1a
+		for (size_t i = 0; i < sizeof(WeldKey); ++i) {
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+		return hash;
+	}
+};
+
+void Mesh::Weld() {
+	if (type != PRIMITIVE_TRIANGLES || IsIndexed() || numVertices == 0) {
+		return;
+	}
+
+	std::unordered_map<WeldKey, uint, WeldKeyHash> unique;
+	std::vector<uint> indices(numVertices);
+	std::vector<uint> firstUse; //which of the old vertices each new one came from
+
+	for (uint i = 0; i < numVertices; ++i) {
+		WeldKey key;
+		memset(&key, 0, sizeof(WeldKey));
+		key.position[0] = vertices[i].x;
+		key.position[1] = vertices[i].y;
+		key.position[2] = vertices[i].z;
+		key.position[3] = vertices[i].w;
+		key.colour		= colours ? colours[i].c : 0;
+		if (textureCoords) {
+			key.texCoord[0] = textureCoords[i].x;
+			key.texCoord[1] = textureCoords[i].y;
+		}
+
+		std::unordered_map<WeldKey, uint, WeldKeyHash>::iterator found = unique.find(key);
+		if (found != unique.end()) {
+			indices[i] = found->second;
+		}
+		else {
+			indices[i] = (uint)firstUse.size();
+			unique[key] = indices[i];
+			firstUse.push_back(i);
+		}
+	}
+
+	uint weldedCount = (uint)firstUse.size();
+
+	Vector4* newVertices		= new Vector4[weldedCount];
+	Colour* newColours			= colours ? new Colour[weldedCount] : NULL;
+	Vector2* newTextureCoords	= textureCoords ? new Vector2[weldedCount] : NULL;
+
+	for (uint i = 0; i < weldedCount; ++i) {
+		newVertices[i] = vertices[firstUse[i]];
+		if (newColours) {
+			newColours[i] = colours[firstUse[i]];
+		}
+		if (newTextureCoords) {
+			newTextureCoords[i] = textureCoords[firstUse[i]];
+		}
+	}
+
+	ReplaceVertices(newVertices, newColours, newTextureCoords, weldedCount);
+	SetIndices(indices);
+}
+
+void Mesh::ReplaceVertices(Vector4* newVertices, Colour* newColours, Vector2* newTextureCoords, uint count) {
+	ClearMeshlets();
+	FreeArray(vertices);
+	FreeArray(colours);
+	FreeArray(textureCoords);
+
+	vertices		= newVertices;
+	colours			= newColours;
+	textureCoords	= newTextureCoords;
+	numVertices		= count;
+	UpdateOpaque();
 }
 
 /*//////////////////////////////////////////////////////////
@@ -37,6 +203,7 @@ Mesh* Mesh::GenerateLine(const Vector3 &from, const Vector3 &to){
 
 	m->type = PRIMITIVE_LINES; //before returning the mesh set it to its primitive type. In this case it is a line. This way the rasterizer knows which pipeline to send it to.
 
+	m->UpdateOpaque();
 	return m;
 }
 
@@ -54,6 +221,7 @@ Mesh* Mesh::GeneratePoints(std::vector<Vector3> v){
 		m->vertices[i] = Vector4(v[i].x, v[i].y, v[i].z, 1.0f);
 	}
 	m->type = PRIMITIVE_POINTS; //before returning the mesh set it to its primitive type. In this case it is a line. This way the rasterizer knows which pipeline to send it to.
+	m->UpdateOpaque();
 	return m;
 }
 
@@ -72,6 +240,7 @@ Mesh* Mesh::GenerateLineStrip(std::vector<Vector3> v){
 			m->colours[i] = Colour(255, 255, 255, 255);
 		}
 		m->type = PRIMITIVE_LINE_STRIPS; //before returning the mesh set it to its primitive type. In this case it is a line. This way the rasterizer knows which pipeline to send it to.
+		m->UpdateOpaque();
 		return m;
 
 	
@@ -93,6 +262,7 @@ Mesh* Mesh::GenerateLineLoop(std::vector<Vector3> v) {
 			m->colours[i] = Colour(255, 255, 255, 255);
 		}
 		m->type = PRIMITIVE_LINE_LOOPS; //before returning the mesh set it to its primitive type. In this case it is a line. This way the rasterizer knows which pipeline to send it to.
+		m->UpdateOpaque();
 		return m;
 }
 
@@ -132,6 +302,7 @@ Mesh* Mesh::GenerateDebris() {
 	m->colours[8] = Colour(192, 192, 192, 255); // grey
 
 	m->type = PRIMITIVE_TRISTRIP;
+	m->UpdateOpaque();
 	return m;
 }
 
@@ -181,6 +352,7 @@ Mesh* Mesh::GenerateRock() {
 
 	m->type = PRIMITIVE_TRIFAN;
 
+	m->UpdateOpaque();
 	return m;
 }
 
@@ -219,6 +391,7 @@ Mesh* Mesh::GenerateSun(Colour * c) {
 	
 	m->type = PRIMITIVE_TRIFAN;
 
+	m->UpdateOpaque();
 	return m;
 }
 
@@ -249,6 +422,7 @@ Mesh* Mesh::GenerateTriangle() {
 
 m->type = PRIMITIVE_TRIANGLES;
 
+	m->UpdateOpaque();
 	return m;
 }
 
@@ -256,7 +430,23 @@ m->type = PRIMITIVE_TRIANGLES;
 //**********	LOAD MESH	********************************
 *///////////////////////////////////////////////////////////
 
-Mesh * Mesh::LoadMeshFile(const string &filename) {
+static bool HasExtension(const string &filename, const string &extension) {
+	return filename.size() >= extension.size() &&
+		!filename.compare(filename.size() - extension.size(), extension.size(), extension);
+}
+
+Mesh * Mesh::LoadMeshFile(const string &filename, bool weld) {
+	if (HasExtension(filename, ".obj")) {
+		return OBJLoader::Load(filename); // already welded
+	}
+	if (HasExtension(filename, ".srmesh")) {
+		Mesh* m = LoadBinaryMeshFile(filename);
+		if (m && weld) {
+			m->Weld();
+		}
+		return m;
+	}
+
 	ifstream f(filename);
 
 	if (!f) {
@@ -306,6 +496,144 @@ Mesh * Mesh::LoadMeshFile(const string &filename) {
 			f >> m->textureCoords[i].y;
 		}
 	}
+	m->UpdateOpaque();
+	if (weld) {
+		m->Weld();
+	}
 	return m;
 
 }
+
+/*//////////////////////////////////////////////////////////
+//**********	BINARY MESH FILES	************************
+*///////////////////////////////////////////////////////////
+
+static size_t AlignToMeshFile(size_t offset) {
+	return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+}
+
+static bool InMeshFile(uint64_t fileSize, uint64_t at, uint64_t bytes) {
+	return (at % MESH_FILE_ALIGNMENT) == 0 && at >= sizeof(MeshFileHeader) &&
+		at <= fileSize && bytes <= fileSize - at;
+}
+
+bool IsValidMeshFileHeader(const MeshFileHeader &header, uint64_t fileSize) {
+	uint64_t vertexCount = header.numVertices;
+
+	bool valid = !memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) &&
+		header.version == MESH_FILE_VERSION &&
+		header.type <= PRIMITIVE_TRISTRIP &&
+		InMeshFile(fileSize, header.verticesOffset, vertexCount * sizeof(Vector4)) &&
+		InMeshFile(fileSize, header.coloursOffset, vertexCount * sizeof(Colour)) &&
+		InMeshFile(fileSize, header.textureCoordsOffset, vertexCount * sizeof(Vector2));
+
+	if (header.numIndices) {
+		valid = valid && header.type == PRIMITIVE_TRIANGLES &&
+			(header.indexSize == sizeof(unsigned short) || header.indexSize == sizeof(uint)) &&
+			InMeshFile(fileSize, header.indicesOffset, (uint64_t)header.numIndices * header.indexSize);
+	}
+	return valid;
+}
+
+//the indices are drawn from as they lie, so one past the end of the vertices
+//would read past them
+template <typename T>
+static bool IndicesInRange(const T* indices, uint count, uint numVertices) {
+	T largest = 0;
+	for (uint i = 0; i < count; ++i) {
+		largest = indices[i] > largest ? indices[i] : largest;
+	}
+	return count == 0 || largest < numVertices;
+}
+
+bool Mesh::SaveBinaryMeshFile(const string &filename) const {
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+	header.version		= MESH_FILE_VERSION;
+	header.type			= type;
+	header.numVertices	= numVertices;
+	header.numIndices	= numIndices;
+	header.indexSize	= indices16 ? sizeof(unsigned short) : (indices32 ? sizeof(uint) : 0);
+
+	const void* streams[4]	= { vertices, colours, textureCoords, indices16 ? (const void*)indices16 : (const void*)indices32 };
+	size_t bytes[4]			= { numVertices * sizeof(Vector4), numVertices * sizeof(Colour),
+		numVertices * sizeof(Vector2), (size_t)numIndices * header.indexSize };
+	uint64_t* offsets[4]	= { &header.verticesOffset, &header.coloursOffset, &header.textureCoordsOffset, &header.indicesOffset };
+
+	size_t offset = AlignToMeshFile(sizeof(header));
+	for (int i = 0; i < 4; ++i) {
+		if (streams[i] && bytes[i]) {
+			*offsets[i] = offset;
+			offset = AlignToMeshFile(offset + bytes[i]);
+		}
+	}
+
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	if (!out.is_open()) {
+		return false;
+	}
+
+	const char padding[MESH_FILE_ALIGNMENT] = { 0 };
+	size_t written = sizeof(header);
+	out.write((const char*)&header, sizeof(header));
+
+	for (int i = 0; i < 4; ++i) {
+		if (*offsets[i]) {
+			out.write(padding, *offsets[i] - written);
+			out.write((const char*)streams[i], bytes[i]);
+			written = *offsets[i] + bytes[i];
+		}
+	}
+	out.write(padding, offset - written);
+
+	return out.good();
+}
+
+Mesh* Mesh::LoadBinaryMeshFile(const string &filename) {
+	MappedFile* file = MappedFile::Open(filename);
+	if (!file || file->GetSize() < sizeof(MeshFileHeader)) {
+		delete file;
+		return NULL;
+	}
+
+	MeshFileHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+
+	if (!IsValidMeshFileHeader(header, file->GetSize())) {
+		delete file;
+		return NULL;
+	}
+
+	const unsigned char* data = file->GetData();
+
+	bool inRange = header.indexSize == sizeof(unsigned short) ?
+		IndicesInRange((const unsigned short*)(data + header.indicesOffset), header.numIndices, header.numVertices) :
+		IndicesInRange((const uint*)(data + header.indicesOffset), header.numIndices, header.numVertices);
+	if (!inRange) {
+		delete file;
+		return NULL;
+	}
+
+	//the streams are only ever read, so pointing straight into the read
+	//only mapping is safe
+	Mesh* m				= new Mesh();
+	m->file				= file;
+	m->type				= (PrimitiveType)header.type;
+	m->numVertices		= header.numVertices;
+	m->vertices			= (Vector4*)(data + header.verticesOffset);
+	m->colours			= (Colour*)(data + header.coloursOffset);
+	m->textureCoords	= (Vector2*)(data + header.textureCoordsOffset);
+
+	if (header.numIndices) {
+		m->numIndices = header.numIndices;
+		if (header.indexSize == sizeof(unsigned short)) {
+			m->indices16 = (unsigned short*)(data + header.indicesOffset);
+		}
+		else {
+			m->indices32 = (uint*)(data + header.indicesOffset);
+		}
+	}
+	m->UpdateOpaque();
+	return m;
+}
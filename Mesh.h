@@ -30,6 +30,8 @@ _-_-_-_-_-_-_-""  ""
 using std::ifstream;
 using std::string;
 
+class MappedFile;
+
 enum PrimitiveType {
 	PRIMITIVE_POINTS,
 	PRIMITIVE_LINES,
@@ -40,8 +42,31 @@ enum PrimitiveType {
 	PRIMITIVE_TRISTRIP
 };
 
+//A small piece of an indexed triangle mesh, with everything needed to tell
+//whether any of it could be seen before any of it is transformed - see
+//MeshOptimiser::BuildMeshlets
+struct Meshlet {
+	uint			firstVertex;	//each meshlet's vertices are next to each other
+	uint			firstTriangle;	//into the mesh's meshletTriangles
+	unsigned char	vertexCount;
+	unsigned char	triangleCount;
+
+	Vector3			centre;			//a sphere around every vertex
+	float			radius;
+
+	//Every triangle faces away from an eye where
+	//Dot(Normalise(coneApex - eye), coneAxis) >= coneCutoff, so from there
+	//the whole meshlet is back facing. A coneCutoff of 1 never culls.
+	Vector3			coneApex;
+	Vector3			coneAxis;
+	float			coneCutoff;
+};
+
 class Mesh	{
 	friend class SoftwareRasteriser;
+	friend class StreamingMesh;
+	friend class OBJLoader;
+	friend class MeshOptimiser;
 public:
 	Mesh(void);
 	~Mesh(void);
@@ -56,7 +81,18 @@ public:
 	static Mesh*	GenerateFanTriangles(std::vector<Vector3> v);
 	static Mesh*    GenerateLineStrip(std::vector<Vector3> v);
 	static Mesh*    GenerateLineLoop(std::vector<Vector3> v);
-	static Mesh*	Mesh::LoadMeshFile(const string &filename);
+	//weld merges vertices that match in every attribute, and draws the
+	//triangles through an index buffer instead - see Weld. Files ending in
+	//.srmesh are loaded with LoadBinaryMeshFile, and .obj with OBJLoader.
+	static Mesh*	LoadMeshFile(const string &filename, bool weld = false);
+
+	//A mesh saved by SaveBinaryMeshFile (see MeshConvert.cpp). The file is
+	//mapped straight into memory and its streams used where they lie, so
+	//loading one costs only the pages that are drawn from - and the indices,
+	//which are all checked to be inside the vertices. NULL if any aren't.
+	static Mesh*	LoadBinaryMeshFile(const string &filename);
+	bool			SaveBinaryMeshFile(const string &filename) const;
+
 	static Mesh*	GenerateRock();
 	static Mesh*	GenerateDebris();
 	static Mesh*	GenerateSun(Colour *);
@@ -64,16 +100,61 @@ public:
 
 
 
-PrimitiveType	GetType() { return type;}
+PrimitiveType	GetType() const { return type;}
+
+	//Indexed triangle lists draw a triangle for every 3 indices, and each
+	//distinct vertex is only transformed once per draw. Only
+	//PRIMITIVE_TRIANGLES meshes use their indices.
+	bool			IsIndexed() const		{ return numIndices > 0; }
+	uint			GetNumIndices() const	{ return numIndices; }
+	uint			GetNumVertices() const	{ return numVertices; }
+
+	//every vertex colour has an alpha of 255 - worked out once, when the
+	//colours are loaded or replaced, not every time the mesh is drawn
+	bool			IsOpaque() const		{ return opaque; }
+
+	//Indices are stored in 16 bits when every vertex can be reached with them
+	void			SetIndices(const std::vector<uint> &indices);
+
+	//Turns a triangle list into an indexed one, with every distinct vertex
+	//stored once. Already indexed meshes are left as they are.
+	void			Weld();
+
+	//Meshes split up into meshlets are drawn a meshlet at a time, and the
+	//ones that are off screen or facing away skipped. Changing the indices
+	//or vertices throws them away.
+	bool			HasMeshlets() const		{ return !meshlets.empty(); }
+	uint			GetNumMeshlets() const	{ return (uint)meshlets.size(); }
+	void			ClearMeshlets();
 
 protected:
+	void			ClearIndices();
+	void			UpdateOpaque();	//whenever the colours change
+
+	//frees an array, unless it's inside the file the mesh was loaded from
+	template <typename T>
+	void			FreeArray(T* &a);
+
+	//takes over the new arrays, and frees the old ones
+	void			ReplaceVertices(Vector4* newVertices, Colour* newColours, Vector2* newTextureCoords, uint count);
+
 	PrimitiveType	type;
 
 	uint			numVertices;
 
+	uint			numIndices;
+	unsigned short*	indices16;	//only one of these is ever set
+	uint*			indices32;
+
 	Vector4*		vertices;
 	Colour*			colours;
 	Vector2*		textureCoords;	//We get onto what to do with these later on...
+	bool			opaque;
+
+	MappedFile*		file;	//what a binary mesh's streams are read from
+
+	std::vector<Meshlet>		meshlets;
+	std::vector<unsigned char>	meshletTriangles;	//3 per triangle, counted from the meshlet's firstVertex
 
 	
 };
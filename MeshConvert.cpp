@@ -0,0 +1,69 @@
+#include "Mesh.h"
+
+#include <cstring>
+#include <iostream>
+
+/*
+Converts a text .mesh or .obj file into the binary format
+Mesh::LoadBinaryMeshFile maps straight into memory, so loading it later
+takes no parsing or copying:
+
+meshconvert input.mesh|input.obj [output.srmesh] [--weld]
+
+The output defaults to the input with its extension swapped for .srmesh.
+--weld merges repeated vertices first and saves the index buffer with them.
+OBJ files always come out welded.
+*/
+
+int main(int argc, char** argv) {
+	const char* input	= NULL;
+	const char* output	= NULL;
+	bool weld			= false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--weld")) {
+			weld = true;
+		}
+		else if (!input) {
+			input = argv[i];
+		}
+		else if (!output) {
+			output = argv[i];
+		}
+		else {
+			std::cerr << "unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+	if (!input) {
+		std::cerr << "meshconvert input.mesh|input.obj [output.srmesh] [--weld]" << std::endl;
+		return 1;
+	}
+
+	string outName = output ? output : string(input);
+	if (!output) {
+		size_t dot = outName.find_last_of('.');
+		outName = outName.substr(0, (dot == string::npos) ? outName.size() : dot) + ".srmesh";
+	}
+
+	Mesh* m = Mesh::LoadMeshFile(input, weld);
+	if (!m || !m->GetNumVertices()) {
+		std::cerr << "couldn't load " << input << std::endl;
+		delete m;
+		return 1;
+	}
+
+	if (!m->SaveBinaryMeshFile(outName)) {
+		std::cerr << "couldn't write " << outName << std::endl;
+		delete m;
+		return 1;
+	}
+	std::cout << "converted " << m->GetNumVertices() << " vertices";
+	if (m->IsIndexed()) {
+		std::cout << " and " << m->GetNumIndices() << " indices";
+	}
+	std::cout << " into " << outName << std::endl;
+
+	delete m;
+	return 0;
+}
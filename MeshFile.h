@@ -0,0 +1,41 @@
+/******************************************************************************
+Class:MeshFileHeader
+Implements:
+Author:Geoff Whitehead
+Description:The layout of the binary .srmesh files Mesh::SaveBinaryMeshFile
+writes, shared by the loaders that read them - Mesh::LoadBinaryMeshFile maps
+the whole file, and StreamingMesh reads it a chunk at a time.
+
+The header is followed by a stream for each vertex attribute, and one for
+the indices, every one starting on a 64 byte boundary, so once mapped
+they're as well aligned as anything new[] hands out. The rasteriser reads
+colours and texture coordinates for every vertex, so only the indices can be
+left out (an offset of 0).
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+static const char		MESH_FILE_MAGIC[4]		= { 'S', 'R', 'M', 'S' };
+static const uint32_t	MESH_FILE_VERSION		= 1;
+static const size_t		MESH_FILE_ALIGNMENT		= 64;
+
+struct MeshFileHeader {
+	char		magic[4];
+	uint32_t	version;
+	uint32_t	type;			//a PrimitiveType
+	uint32_t	numVertices;
+	uint32_t	numIndices;
+	uint32_t	indexSize;		//2 or 4 bytes, or 0 without indices
+	uint64_t	verticesOffset;	//Vector4s
+	uint64_t	coloursOffset;	//Colours
+	uint64_t	textureCoordsOffset;	//Vector2s
+	uint64_t	indicesOffset;
+};
+
+//true if every stream the header describes lies inside a file of fileSize
+//bytes, where the rest of it says it should
+bool	IsValidMeshFileHeader(const MeshFileHeader &header, uint64_t fileSize);
@@ -0,0 +1,700 @@
+#include "MeshOptimiser.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+static const uint NO_INDEX = 0xFFFFFFFF;
+
+static bool CanOptimise(const Mesh* m) {
+	return m->GetType() == PRIMITIVE_TRIANGLES && m->IsIndexed() && m->GetNumIndices() >= 3;
+}
+
+std::vector<uint> MeshOptimiser::GetIndices(const Mesh* m) {
+	std::vector<uint> indices(m->GetNumIndices() - m->GetNumIndices() % 3);
+	for (uint i = 0; i < indices.size(); ++i) {
+		indices[i] = m->indices16 ? m->indices16[i] : m->indices32[i];
+	}
+	return indices;
+}
+
+//how many vertices a FIFO cache of cacheSize misses drawing indices[first,
+//last), starting empty. stamps is NO_INDEX for every vertex, and is left
+//that way.
+static uint CacheMisses(const std::vector<uint> &indices, size_t first, size_t last, uint cacheSize, std::vector<uint> &stamps) {
+	uint misses = 0;
+	for (size_t i = first; i < last; ++i) {
+		uint v = indices[i];
+		if (stamps[v] == NO_INDEX || misses - stamps[v] >= cacheSize) {
+			stamps[v] = misses; // FIFO: only a miss moves a vertex back to the front
+			misses++;
+		}
+	}
+	for (size_t i = first; i < last; ++i) {
+		stamps[indices[i]] = NO_INDEX;
+	}
+	return misses;
+}
+
+//every vertex's triangles, packed one vertex after another: vertex v's are
+//triangles[first[v]] up to triangles[first[v + 1]]
+static void FindVertexTriangles(const std::vector<uint> &indices, uint numVertices,
+	std::vector<uint> &first, std::vector<uint> &triangles) {
+	first.assign(numVertices + 1, 0);
+	for (uint i = 0; i < indices.size(); ++i) {
+		first[indices[i] + 1]++;
+	}
+	for (uint v = 0; v < numVertices; ++v) {
+		first[v + 1] += first[v];
+	}
+	triangles.resize(indices.size());
+	std::vector<uint> filled(first.begin(), first.end() - 1);
+	for (uint i = 0; i < indices.size(); ++i) {
+		triangles[filled[indices[i]]++] = i / 3;
+	}
+}
+
+void MeshOptimiser::Optimise(Mesh* m) {
+	if (m->GetType() == PRIMITIVE_TRIANGLES && !m->IsIndexed()) {
+		m->Weld();
+	}
+	if (!CanOptimise(m)) {
+		return;
+	}
+	OptimiseVertexCache(m);
+	OptimiseOverdraw(m);
+	OptimiseVertexFetch(m);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	VERTEX CACHE	****************************
+*///////////////////////////////////////////////////////////
+
+//Forsyth's scoring, for an LRU cache of 32 vertices. Vertices near the front
+//of the cache score highest (apart from the last triangle's, so strips don't
+//turn back on themselves), and vertices with few triangles left score a
+//boost so they're finished off rather than left stranded.
+static const int	FORSYTH_CACHE_SIZE = 32;
+
+static float VertexScore(int cachePosition, uint trianglesLeft) {
+	if (trianglesLeft == 0) {
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			score = 0.75f;
+		}
+		else {
+			score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+	}
+	return score + 2.0f / sqrtf((float)trianglesLeft);
+}
+
+void MeshOptimiser::OptimiseVertexCache(Mesh* m) {
+	if (!CanOptimise(m)) {
+		return;
+	}
+	std::vector<uint> indices = GetIndices(m);
+	uint numTris		= (uint)indices.size() / 3;
+	uint numVertices	= m->GetNumVertices();
+
+	std::vector<uint> firstTriangle;
+	std::vector<uint> vertexTriangles;
+	FindVertexTriangles(indices, numVertices, firstTriangle, vertexTriangles);
+
+	std::vector<uint> trianglesLeft(numVertices);
+	for (uint v = 0; v < numVertices; ++v) {
+		trianglesLeft[v] = firstTriangle[v + 1] - firstTriangle[v];
+	}
+
+	std::vector<int> cachePosition(numVertices, -1);
+	std::vector<float> vertexScore(numVertices);
+	for (uint v = 0; v < numVertices; ++v) {
+		vertexScore[v] = VertexScore(-1, trianglesLeft[v]);
+	}
+	std::vector<float> triangleScore(numTris);
+	for (uint t = 0; t < numTris; ++t) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(numTris, false);
+	std::vector<uint> output;
+	output.reserve(indices.size());
+
+	//one more than the cache holds, for the vertices a triangle pushes out
+	std::vector<uint> cache;
+	std::vector<uint> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	uint best		= 0;
+	uint nextUnused	= 0; //where to look for a fresh start when nothing in the cache has triangles left
+
+	for (uint emittedCount = 0; emittedCount < numTris; ++emittedCount) {
+		if (best == NO_INDEX) {
+			while (emitted[nextUnused]) {
+				nextUnused++;
+			}
+			best = nextUnused;
+		}
+
+		emitted[best] = true;
+		newCache.clear();
+		for (int i = 0; i < 3; ++i) {
+			uint v = indices[best * 3 + i];
+			output.push_back(v);
+			newCache.push_back(v);
+
+			//take the triangle out of the vertex's list
+			uint* tris	= &vertexTriangles[firstTriangle[v]];
+			uint count	= trianglesLeft[v];
+			for (uint j = 0; j < count; ++j) {
+				if (tris[j] == best) {
+					tris[j] = tris[count - 1];
+					break;
+				}
+			}
+			trianglesLeft[v]--;
+		}
+		for (uint i = 0; i < cache.size(); ++i) {
+			uint v = cache[i];
+			if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+				newCache.push_back(v);
+			}
+		}
+		cache.swap(newCache);
+
+		//rescore everything in the cache, and the triangles they're in. The
+		//ones pushed out of the end score as uncached.
+		best = NO_INDEX;
+		float bestScore = -FLT_MAX;
+		for (uint i = 0; i < cache.size(); ++i) {
+			uint v = cache[i];
+			int position = (i < (uint)FORSYTH_CACHE_SIZE) ? (int)i : -1;
+			cachePosition[v] = position;
+
+			float newScore	= VertexScore(position, trianglesLeft[v]);
+			float change	= newScore - vertexScore[v];
+			vertexScore[v]	= newScore;
+
+			const uint* tris = &vertexTriangles[firstTriangle[v]];
+			for (uint j = 0; j < trianglesLeft[v]; ++j) {
+				triangleScore[tris[j]] += change;
+				if (triangleScore[tris[j]] > bestScore) {
+					bestScore	= triangleScore[tris[j]];
+					best		= tris[j];
+				}
+			}
+		}
+		if (cache.size() > (size_t)FORSYTH_CACHE_SIZE) {
+			cache.resize(FORSYTH_CACHE_SIZE);
+		}
+	}
+
+	m->SetIndices(output);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	OVERDRAW	********************************
+*///////////////////////////////////////////////////////////
+
+struct OverdrawCluster {
+	uint	first;	//triangle
+	uint	count;
+	float	sortKey;
+};
+
+static Vector3 Position(const Vector4 &v) {
+	return Vector3(v.x, v.y, v.z);
+}
+
+void MeshOptimiser::OptimiseOverdraw(Mesh* m, float threshold) {
+	if (!CanOptimise(m)) {
+		return;
+	}
+	std::vector<uint> indices = GetIndices(m);
+	uint numTris = (uint)indices.size() / 3;
+
+	std::vector<uint> stamps(m->GetNumVertices(), NO_INDEX);
+
+	//Hard boundaries are wherever the cache order started again somewhere
+	//new - triangles that miss on all 3 vertices
+	std::vector<uint> hardStarts;
+	{
+		uint misses = 0;
+		for (uint t = 0; t < numTris; ++t) {
+			uint triMisses = 0;
+			for (int i = 0; i < 3; ++i) {
+				uint v = indices[t * 3 + i];
+				if (stamps[v] == NO_INDEX || misses - stamps[v] >= DEFAULT_CACHE_SIZE) {
+					stamps[v] = misses++;
+					triMisses++;
+				}
+			}
+			if (triMisses == 3 || t == 0) {
+				hardStarts.push_back(t);
+			}
+		}
+		std::fill(stamps.begin(), stamps.end(), NO_INDEX);
+	}
+	hardStarts.push_back(numTris);
+
+	//...and each of those is cut again wherever the ACMR of what's been
+	//drawn since the last cut is within threshold of the whole cluster's,
+	//so starting the cache again there costs little
+	std::vector<OverdrawCluster> clusters;
+	for (size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+		uint first	= hardStarts[h];
+		uint last	= hardStarts[h + 1];
+		float limit = threshold * CacheMisses(indices, first * 3, last * 3, DEFAULT_CACHE_SIZE, stamps) / (last - first);
+
+		uint start	= first;
+		uint misses = 0;
+		for (uint t = first; t < last; ++t) {
+			for (int i = 0; i < 3; ++i) {
+				uint v = indices[t * 3 + i];
+				if (stamps[v] == NO_INDEX || misses - stamps[v] >= DEFAULT_CACHE_SIZE) {
+					stamps[v] = misses++;
+				}
+			}
+			uint drawn = t + 1 - start;
+			if (t + 1 == last || (drawn >= 8 && (float)misses / drawn <= limit)) {
+				OverdrawCluster c;
+				c.first = start;
+				c.count = drawn;
+				clusters.push_back(c);
+
+				for (uint i = start * 3; i < (t + 1) * 3; ++i) {
+					stamps[indices[i]] = NO_INDEX;
+				}
+				start	= t + 1;
+				misses	= 0;
+			}
+		}
+	}
+
+	//clusters facing away from the middle of the mesh go first
+	Vector3 meshCentre;
+	float meshArea = 0.0f;
+	std::vector<Vector3> clusterCentre(clusters.size());
+	std::vector<Vector3> clusterNormal(clusters.size());
+
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		Vector3 centre;
+		Vector3 normal;
+		float area = 0.0f;
+		for (uint t = clusters[c].first; t < clusters[c].first + clusters[c].count; ++t) {
+			Vector3 a = Position(m->vertices[indices[t * 3]]);
+			Vector3 b = Position(m->vertices[indices[t * 3 + 1]]);
+			Vector3 d = Position(m->vertices[indices[t * 3 + 2]]);
+
+			Vector3 n		= Vector3::Cross(b - a, d - a); //as long as the triangle's twice its area
+			float triArea	= n.Length();
+			centre	+= (a + b + d) * (triArea / 3.0f);
+			normal	+= n;
+			area	+= triArea;
+		}
+		meshCentre	+= centre;
+		meshArea	+= area;
+
+		clusterCentre[c] = (area > 0.0f) ? centre / area : centre;
+		if (normal.Length() > 0.0f) {
+			normal.Normalise();
+		}
+		clusterNormal[c] = normal;
+	}
+	if (meshArea > 0.0f) {
+		meshCentre = meshCentre / meshArea;
+	}
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		clusters[c].sortKey = Vector3::Dot(clusterCentre[c] - meshCentre, clusterNormal[c]);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const OverdrawCluster &a, const OverdrawCluster &b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint> output;
+	output.reserve(indices.size());
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		output.insert(output.end(), indices.begin() + clusters[c].first * 3,
+			indices.begin() + (clusters[c].first + clusters[c].count) * 3);
+	}
+
+	//Facing out from the middle is only a guess at what's in front - on
+	//flat or open meshes, like height fields, it can be the wrong way round.
+	//The new order is only kept if it really does draw less.
+	if (MeasureOverdraw(m, output) < MeasureOverdraw(m, indices)) {
+		m->SetIndices(output);
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	VERTEX FETCH	****************************
+*///////////////////////////////////////////////////////////
+
+void MeshOptimiser::OptimiseVertexFetch(Mesh* m) {
+	if (!CanOptimise(m)) {
+		return;
+	}
+	std::vector<uint> indices = GetIndices(m);
+
+	//vertices no triangle uses are dropped
+	std::vector<uint> remap(m->numVertices, NO_INDEX);
+	std::vector<uint> order;
+	for (uint i = 0; i < indices.size(); ++i) {
+		uint &to = remap[indices[i]];
+		if (to == NO_INDEX) {
+			to = (uint)order.size();
+			order.push_back(indices[i]);
+		}
+		indices[i] = to;
+	}
+
+	uint count = (uint)order.size();
+	Vector4* newVertices		= new Vector4[count];
+	Colour* newColours			= m->colours ? new Colour[count] : NULL;
+	Vector2* newTextureCoords	= m->textureCoords ? new Vector2[count] : NULL;
+
+	for (uint i = 0; i < count; ++i) {
+		newVertices[i] = m->vertices[order[i]];
+		if (newColours) {
+			newColours[i] = m->colours[order[i]];
+		}
+		if (newTextureCoords) {
+			newTextureCoords[i] = m->textureCoords[order[i]];
+		}
+	}
+
+	m->ReplaceVertices(newVertices, newColours, newTextureCoords, count);
+	m->SetIndices(indices);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	MESHLETS	********************************
+*///////////////////////////////////////////////////////////
+
+//The sphere is centred on the box around the vertices. The cone's axis is
+//the average of the triangles' normals, and it's only any use if they're
+//all within about 84 degrees of it; its apex is pulled back along the axis
+//until it's behind the plane of every triangle.
+static void CalculateMeshletBounds(Meshlet &meshlet, const Vector4* vertices, const unsigned char* triangles) {
+	Vector3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (uint i = 0; i < meshlet.vertexCount; ++i) {
+		Vector3 p = Position(vertices[i]);
+		low		= Vector3(min(low.x, p.x), min(low.y, p.y), min(low.z, p.z));
+		high	= Vector3(max(high.x, p.x), max(high.y, p.y), max(high.z, p.z));
+	}
+	meshlet.centre = (low + high) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (uint i = 0; i < meshlet.vertexCount; ++i) {
+		meshlet.radius = max(meshlet.radius, (Position(vertices[i]) - meshlet.centre).Length());
+	}
+
+	meshlet.coneApex	= meshlet.centre;
+	meshlet.coneAxis	= Vector3(0, 0, 0);
+	meshlet.coneCutoff	= 1.0f;
+
+	std::vector<Vector3> normals;
+	Vector3 axis;
+	for (uint t = 0; t < meshlet.triangleCount; ++t) {
+		Vector3 a = Position(vertices[triangles[t * 3]]);
+		Vector3 b = Position(vertices[triangles[t * 3 + 1]]);
+		Vector3 c = Position(vertices[triangles[t * 3 + 2]]);
+		Vector3 n = Vector3::Cross(b - a, c - a);
+		if (n.Length() > 0.0f) {
+			n.Normalise();
+			normals.push_back(n);
+			axis += n;
+		}
+	}
+	if (normals.empty() || axis.Length() == 0.0f) {
+		return;
+	}
+	axis.Normalise();
+
+	float minDot = 1.0f;
+	for (size_t i = 0; i < normals.size(); ++i) {
+		minDot = min(minDot, Vector3::Dot(normals[i], axis));
+	}
+	if (minDot <= 0.1f) {
+		return;
+	}
+
+	float pullBack = 0.0f;
+	for (uint t = 0, n = 0; t < meshlet.triangleCount; ++t) {
+		Vector3 a = Position(vertices[triangles[t * 3]]);
+		Vector3 b = Position(vertices[triangles[t * 3 + 1]]);
+		Vector3 c = Position(vertices[triangles[t * 3 + 2]]);
+		if (Vector3::Cross(b - a, c - a).Length() == 0.0f) {
+			continue;
+		}
+		const Vector3 &normal = normals[n++];
+		pullBack = max(pullBack, Vector3::Dot(meshlet.centre - a, normal) / Vector3::Dot(axis, normal));
+	}
+
+	meshlet.coneApex	= meshlet.centre - axis * pullBack;
+	meshlet.coneAxis	= axis;
+	meshlet.coneCutoff	= sqrtf(1.0f - minDot * minDot);
+}
+
+void MeshOptimiser::BuildMeshlets(Mesh* m, uint maxVertices, uint maxTriangles) {
+	if (!CanOptimise(m)) {
+		return;
+	}
+	maxVertices		= min(max(maxVertices, 3u), 255u);
+	maxTriangles	= min(max(maxTriangles, 1u), 255u);
+
+	std::vector<uint> indices = GetIndices(m);
+	uint numTris = (uint)indices.size() / 3;
+
+	std::vector<uint> firstTriangle;
+	std::vector<uint> vertexTriangles;
+	FindVertexTriangles(indices, m->numVertices, firstTriangle, vertexTriangles);
+
+	std::vector<Vector3> normals(numTris);
+	for (uint t = 0; t < numTris; ++t) {
+		Vector3 a = Position(m->vertices[indices[t * 3]]);
+		normals[t] = Vector3::Cross(Position(m->vertices[indices[t * 3 + 1]]) - a, Position(m->vertices[indices[t * 3 + 2]]) - a);
+		if (normals[t].Length() > 0.0f) {
+			normals[t].Normalise();
+		}
+	}
+
+	//Each meshlet starts from the first triangle not yet used, and grows
+	//across the triangles next to it: the ones adding fewest new vertices
+	//first, then the ones facing the same way as it most, so its cone stays
+	//narrow. It's finished once nothing next to it fits.
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned char> triangles;
+	std::vector<uint> order;	//which old vertex each new one is
+	std::vector<uint> newIndices;
+	newIndices.reserve(indices.size());
+
+	std::vector<bool> used(numTris, false);
+	std::vector<int> local(m->numVertices, -1);	//in the current meshlet
+	uint nextSeed = 0;
+
+	Meshlet current = Meshlet();
+	Vector3 facing;	//the sum of the current meshlet's normals
+
+	for (uint added = 0; added < numTris; ++added) {
+		uint best = NO_INDEX;
+		if (current.triangleCount < maxTriangles) {
+			uint bestNew		= 4;
+			float bestFacing	= -FLT_MAX;
+			for (uint i = 0; i < current.vertexCount; ++i) {
+				uint v = order[current.firstVertex + i];
+				for (uint j = firstTriangle[v]; j < firstTriangle[v + 1]; ++j) {
+					uint t = vertexTriangles[j];
+					if (used[t]) {
+						continue;
+					}
+					uint a = indices[t * 3];
+					uint b = indices[t * 3 + 1];
+					uint c = indices[t * 3 + 2];
+					uint newVertices = (local[a] < 0 ? 1 : 0) + ((local[b] < 0 && b != a) ? 1 : 0) + ((local[c] < 0 && c != a && c != b) ? 1 : 0);
+					if (current.vertexCount + newVertices > maxVertices) {
+						continue;
+					}
+					float f = Vector3::Dot(normals[t], facing);
+					if (newVertices < bestNew || (newVertices == bestNew && (f > bestFacing || (f == bestFacing && t < best)))) {
+						best		= t;
+						bestNew		= newVertices;
+						bestFacing	= f;
+					}
+				}
+			}
+		}
+
+		if (best == NO_INDEX) {
+			if (current.triangleCount) {
+				for (uint i = 0; i < current.vertexCount; ++i) {
+					local[order[current.firstVertex + i]] = -1;
+				}
+				meshlets.push_back(current);
+			}
+			current.firstVertex		= (uint)order.size();
+			current.firstTriangle	= (uint)triangles.size() / 3;
+			current.vertexCount		= 0;
+			current.triangleCount	= 0;
+			facing = Vector3(0, 0, 0);
+
+			while (used[nextSeed]) {
+				nextSeed++;
+			}
+			best = nextSeed;
+		}
+
+		used[best] = true;
+		facing += normals[best];
+		for (int i = 0; i < 3; ++i) {
+			uint v = indices[best * 3 + i];
+			if (local[v] < 0) {
+				local[v] = current.vertexCount++;
+				order.push_back(v);
+			}
+			triangles.push_back((unsigned char)local[v]);
+			newIndices.push_back(current.firstVertex + local[v]);
+		}
+		current.triangleCount++;
+	}
+	meshlets.push_back(current);
+
+	uint count = (uint)order.size();
+	Vector4* newVertices		= new Vector4[count];
+	Colour* newColours			= m->colours ? new Colour[count] : NULL;
+	Vector2* newTextureCoords	= m->textureCoords ? new Vector2[count] : NULL;
+
+	for (uint i = 0; i < count; ++i) {
+		newVertices[i] = m->vertices[order[i]];
+		if (newColours) {
+			newColours[i] = m->colours[order[i]];
+		}
+		if (newTextureCoords) {
+			newTextureCoords[i] = m->textureCoords[order[i]];
+		}
+	}
+
+	m->ReplaceVertices(newVertices, newColours, newTextureCoords, count);
+	m->SetIndices(newIndices);
+
+	for (size_t i = 0; i < meshlets.size(); ++i) {
+		CalculateMeshletBounds(meshlets[i], m->vertices + meshlets[i].firstVertex, &triangles[meshlets[i].firstTriangle * 3]);
+	}
+	m->meshlets.swap(meshlets);
+	m->meshletTriangles.swap(triangles);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	ANALYSE	************************************
+*///////////////////////////////////////////////////////////
+
+static const int OVERDRAW_VIEW_SIZE = 256;
+
+//Draws the triangles into a depth buffer looking along forward, with the
+//mesh fitted to the view, and counts the pixels that pass the depth test
+//and the pixels covered at all. Only triangles facing the view are drawn,
+//as the rasteriser would.
+static void CountOverdraw(const std::vector<Vector3> &positions, const std::vector<uint> &indices,
+	const Vector3 &right, const Vector3 &up, const Vector3 &forward, uint64_t &shaded, uint64_t &covered) {
+	const int size = OVERDRAW_VIEW_SIZE;
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	std::vector<Vector3> projected(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		projected[i] = Vector3(Vector3::Dot(positions[i], right), Vector3::Dot(positions[i], up), Vector3::Dot(positions[i], forward));
+		minX = min(minX, projected[i].x);
+		minY = min(minY, projected[i].y);
+		maxX = max(maxX, projected[i].x);
+		maxY = max(maxY, projected[i].y);
+	}
+	float scale = (size - 1) / max(max(maxX - minX, maxY - minY), FLT_MIN);
+
+	std::vector<float> depth(size * size, FLT_MAX);
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		Vector3 p[3];
+		for (int i = 0; i < 3; ++i) {
+			const Vector3 &v = projected[indices[t + i]];
+			p[i] = Vector3((v.x - minX) * scale + 0.5f, (v.y - minY) * scale + 0.5f, v.z);
+		}
+		float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+		if (area <= 0.0f) {
+			continue;
+		}
+
+		int x0 = max((int)floorf(min(min(p[0].x, p[1].x), p[2].x)), 0);
+		int y0 = max((int)floorf(min(min(p[0].y, p[1].y), p[2].y)), 0);
+		int x1 = min((int)ceilf(max(max(p[0].x, p[1].x), p[2].x)), size - 1);
+		int y1 = min((int)ceilf(max(max(p[0].y, p[1].y), p[2].y)), size - 1);
+
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				float px = x + 0.5f;
+				float py = y + 0.5f;
+				float w0 = (p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x);
+				float w1 = (p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x);
+				float w2 = (p[1].x - p[0].x) * (py - p[0].y) - (p[1].y - p[0].y) * (px - p[0].x);
+
+				//pixels exactly on an edge go to the triangle on its left
+				//or top, so shared edges aren't counted twice
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ||
+					(w0 == 0.0f && (p[2].y < p[1].y || (p[2].y == p[1].y && p[2].x > p[1].x))) ||
+					(w1 == 0.0f && (p[0].y < p[2].y || (p[0].y == p[2].y && p[0].x > p[2].x))) ||
+					(w2 == 0.0f && (p[1].y < p[0].y || (p[1].y == p[0].y && p[1].x > p[0].x)))) {
+					continue;
+				}
+				float z = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+				float &d = depth[y * size + x];
+				if (z < d) {
+					covered += (d == FLT_MAX) ? 1 : 0;
+					shaded++;
+					d = z;
+				}
+			}
+		}
+	}
+}
+
+float MeshOptimiser::MeasureOverdraw(const Mesh* m, const std::vector<uint> &indices) {
+	std::vector<Vector3> positions(m->GetNumVertices());
+	for (uint i = 0; i < m->GetNumVertices(); ++i) {
+		positions[i] = Position(m->vertices[i]);
+	}
+
+	//looking in along each axis in both directions, with right x up pointing
+	//back at the viewer
+	const Vector3 views[6][3] = {
+		{ Vector3( 1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, -1) },
+		{ Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0,  1) },
+		{ Vector3(0, 0, -1), Vector3(0, 1, 0), Vector3(-1, 0, 0) },
+		{ Vector3(0, 0,  1), Vector3(0, 1, 0), Vector3( 1, 0, 0) },
+		{ Vector3(1, 0, 0), Vector3(0, 0, -1), Vector3(0, -1, 0) },
+		{ Vector3(1, 0, 0), Vector3(0, 0,  1), Vector3(0,  1, 0) }
+	};
+
+	uint64_t shaded		= 0;
+	uint64_t covered	= 0;
+	for (int v = 0; v < 6; ++v) {
+		CountOverdraw(positions, indices, views[v][0], views[v][1], views[v][2], shaded, covered);
+	}
+	return covered ? (float)shaded / covered : 0.0f;
+}
+
+MeshStats MeshOptimiser::Analyse(const Mesh* m, uint cacheSize) {
+	MeshStats stats;
+	stats.acmr		= 0.0f;
+	stats.atvr		= 0.0f;
+	stats.overdraw	= 0.0f;
+
+	if (m->GetType() != PRIMITIVE_TRIANGLES || m->GetNumVertices() < 3) {
+		return stats;
+	}
+
+	//an unindexed mesh draws every vertex once
+	std::vector<uint> indices;
+	if (m->IsIndexed()) {
+		indices = GetIndices(m);
+	}
+	else {
+		indices.resize(m->GetNumVertices() - m->GetNumVertices() % 3);
+		for (uint i = 0; i < indices.size(); ++i) {
+			indices[i] = i;
+		}
+	}
+	if (indices.empty()) {
+		return stats;
+	}
+
+	std::vector<uint> stamps(m->GetNumVertices(), NO_INDEX);
+	uint misses = CacheMisses(indices, 0, indices.size(), max(cacheSize, 1u), stamps);
+	stats.acmr = (float)misses / (indices.size() / 3);
+	stats.atvr = (float)misses / m->GetNumVertices();
+
+	stats.overdraw = MeasureOverdraw(m, indices);
+	return stats;
+}
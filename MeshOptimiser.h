@@ -0,0 +1,81 @@
+/******************************************************************************
+Class:MeshOptimiser
+Implements:
+Author:Geoff Whitehead
+Description:Reorders the triangles and vertices of indexed triangle meshes,
+without changing what they look like, so they're cheaper to draw:
+
+OptimiseVertexCache puts triangles that share vertices next to each other
+(Tom Forsyth's linear speed vertex cache optimisation), so a post transform
+cache would transform each vertex as few times as possible.
+
+OptimiseOverdraw then cuts that order into clusters, at the points it can
+without losing much of the cache order, and draws the clusters facing out
+from the middle of the mesh first. Whichever way it's seen from, those are
+the most likely to be in front, so more of the rest fails the depth test
+(and Hi-Z) before being shaded. That's only a guess, so the new order is
+measured against the old one (as Analyse does), and only kept if it's less
+overdraw.
+
+OptimiseVertexFetch last of all renumbers the vertices in the order the
+triangles first use them, so reading them walks through memory in order.
+
+BuildMeshlets splits a mesh into meshlets, each with the bounds the
+rasteriser culls it with. Each grows out from the first triangle not yet in
+one across its neighbours, preferring those facing the same way, so works
+best on a mesh that's been through the passes above.
+
+Analyse measures how well that worked: the ACMR (vertices a FIFO cache
+misses per triangle), the ATVR (the same, per vertex, where 1 is perfect)
+and overdraw (pixels shaded per pixel covered, averaged over views from
+the 6 axis directions).
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+struct MeshStats {
+	float	acmr;
+	float	atvr;
+	float	overdraw;
+};
+
+class MeshOptimiser {
+public:
+	//All three, in order. Unindexed triangle meshes are welded first; any
+	//other kind of mesh is left alone.
+	static void			Optimise(Mesh* m);
+
+	static void			OptimiseVertexCache(Mesh* m);
+
+	//threshold is how much worse than the cache order the ACMR of a cluster
+	//is allowed to get by cutting it up - 1.05 allows 5%
+	static void			OptimiseOverdraw(Mesh* m, float threshold = 1.05f);
+
+	static void			OptimiseVertexFetch(Mesh* m);
+
+	//The vertices are rearranged so each meshlet's are together, which
+	//stores the ones shared between meshlets more than once. No more than
+	//255 vertices, or triangles, fit in a meshlet.
+	static void			BuildMeshlets(Mesh* m, uint maxVertices = MESHLET_VERTICES, uint maxTriangles = MESHLET_TRIANGLES);
+
+	static MeshStats	Analyse(const Mesh* m, uint cacheSize = DEFAULT_CACHE_SIZE);
+
+	//the size of FIFO cache that Analyse and OptimiseOverdraw model
+	static const uint	DEFAULT_CACHE_SIZE = 16;
+
+	static const uint	MESHLET_VERTICES	= 64;
+	static const uint	MESHLET_TRIANGLES	= 126;
+
+protected:
+	//a whole number of triangles' worth, whichever size they're stored in
+	static std::vector<uint>	GetIndices(const Mesh* m);
+
+	//pixels shaded per pixel covered, seen from the 6 axis directions, with
+	//the triangles drawn in the order indices has them
+	static float				MeasureOverdraw(const Mesh* m, const std::vector<uint> &indices);
+};
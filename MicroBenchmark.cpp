@@ -0,0 +1,686 @@
+#include "SoftwareRasteriser.h"
+
+#include "Texture.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+Times the rasteriser's hot paths one at a time, on synthetic workloads, so a
+change to one of them can be measured without the rest of a scene getting in
+the way. Each case is run for at least --time seconds, and reports the time
+per operation, plus pixels and triangles per second where they mean
+something, and the last level cache misses per operation where the processor
+will count them for us (Linux's perf events, outside most virtual machines).
+Pixel counts are the ideal area of each primitive, not the number of pixels
+actually written.
+
+microbenchmark [--width W] [--height H] [--time seconds] [--filter text]
+	[--format text|csv|json]
+*/
+
+/*//////////////////////////////////////////////////////////
+//**********	TEST SUBJECTS	****************************
+*///////////////////////////////////////////////////////////
+
+//Opens up the protected parts of the rasteriser we want to time
+class BenchRasteriser : public SoftwareRasteriser {
+public:
+	BenchRasteriser(uint width, uint height) : SoftwareRasteriser(width, height) {}
+
+	using SoftwareRasteriser::RasteriseTri;
+	using SoftwareRasteriser::RasteriseLine;
+	using SoftwareRasteriser::SutherlandHodgmanTri;
+	using SoftwareRasteriser::CohenSutherlandLine;
+
+	void	SetTexture(Texture* t)			{ currentTexture = t; SelectShadeBlock(!t || t->IsOpaque()); }
+	void	SetSampleState(SampleState s)	{ texSampleState = s; SelectShadeBlock(!currentTexture || currentTexture->IsOpaque()); }
+	void	SetBlending()					{ SelectShadeBlock(false); }
+};
+
+//A square texture of made up texels, so nothing needs loading from disk
+class BenchTexture : public Texture {
+public:
+	BenchTexture(uint size) {
+		width	= size;
+		height	= size;
+		texels	= new Colour[size * size];
+
+		for (uint i = 0; i < size * size; ++i) {
+			texels[i].c = (i * 2654435761u) | 0xFF000000;
+		}
+		CreateMipMaps();
+	}
+
+	void	RebuildMipMaps() {
+		CreateMipMaps();
+	}
+};
+
+/*//////////////////////////////////////////////////////////
+//**********	CASES	************************************
+*///////////////////////////////////////////////////////////
+
+struct MicroCase {
+	std::string					name;
+	uint						batch;		//operations per call of run
+	double						pixelsPerOp;
+	double						trisPerOp;
+	std::function<void(uint)>	run;
+};
+
+struct MicroResult {
+	std::string	name;
+	uint64_t	ops;
+	double		nsPerOp;
+	double		mPixelsPerSec;	//0 where it doesn't apply
+	double		trisPerSec;
+	double		cacheMissesPerOp;	//less than 0 where they couldn't be counted
+};
+
+//The processor's own count of last level cache misses, for this process only
+class CacheMissCounter {
+public:
+	CacheMissCounter() {
+		fd = -1;
+#ifdef __linux__
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size			= sizeof(attr);
+		attr.type			= PERF_TYPE_HARDWARE;
+		attr.config			= PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled		= 1;
+		attr.exclude_kernel	= 1;
+		attr.exclude_hv		= 1;
+		fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+
+	~CacheMissCounter() {
+#ifdef __linux__
+		if (fd >= 0) {
+			close(fd);
+		}
+#endif
+	}
+
+	bool	IsAvailable() const { return fd >= 0; }
+
+	void	Start() {
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	uint64_t	Stop() {
+		uint64_t count = 0;
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+				count = 0;
+			}
+		}
+#endif
+		return count;
+	}
+
+protected:
+	int	fd;
+};
+
+static volatile unsigned int sink; //stops sampling loops being thrown away
+
+static float ToNDC(float pixel, uint size) {
+	return (pixel / (size - 1)) * 2.0f - 1.0f;
+}
+
+static double PixelArea(const Vector2 &a, const Vector2 &b, const Vector2 &c) {
+	return abs(((b.x - a.x) * (c.y - a.y)) - ((c.x - a.x) * (b.y - a.y))) * 0.5;
+}
+
+static const char* SampleStateName(SoftwareRasteriser::SampleState s) {
+	switch (s) {
+	case SoftwareRasteriser::SAMPLE_NEAREST:			return "nearest";
+	case SoftwareRasteriser::SAMPLE_BILINEAR:			return "bilinear";
+	case SoftwareRasteriser::SAMPLE_MIPMAP_NEAREST:		return "mipmap_nearest";
+	case SoftwareRasteriser::SAMPLE_MIPMAP_BILINEAR:	return "mipmap_bilinear";
+	}
+	return "";
+}
+
+//a triangle given in pixels, drawn through RasteriseTri with the rasteriser
+//in whatever state setup leaves it in
+static MicroCase TriCase(BenchRasteriser &r, const std::string &name, uint width, uint height,
+	Vector2 a, Vector2 b, Vector2 c, std::function<void()> setup) {
+
+	Vector4 v0(ToNDC(a.x, width), ToNDC(a.y, height), 0.5f, 1.0f);
+	Vector4 v1(ToNDC(b.x, width), ToNDC(b.y, height), 0.5f, 1.0f);
+	Vector4 v2(ToNDC(c.x, width), ToNDC(c.y, height), 0.5f, 1.0f);
+
+	MicroCase m;
+	m.name			= name;
+	m.batch			= 16;
+	m.pixelsPerOp	= PixelArea(a, b, c);
+	m.trisPerOp		= 1.0;
+	m.run = [&r, v0, v1, v2, setup](uint n) {
+		setup();
+		for (uint i = 0; i < n; ++i) {
+			r.RasteriseTri(v0, v1, v2,
+				Colour(255, 0, 0, 255), Colour(0, 255, 0, 255), Colour(0, 0, 255, 255),
+				Vector3(0, 0, 1), Vector3(1, 0, 1), Vector3(0, 1, 1));
+		}
+	};
+	return m;
+}
+
+static std::vector<MicroCase> BuildCases(BenchRasteriser &r, BenchTexture &texture, uint width, uint height) {
+	std::vector<MicroCase> cases;
+
+	const float w = (float)width;
+	const float h = (float)height;
+
+	std::function<void()> untextured = [&r]() {
+		r.SetTexture(NULL);
+	};
+
+	//RasteriseTri, with the default kernel and the edge function fill
+	cases.push_back(TriCase(r, "RasteriseTri/small", width, height,
+		Vector2(w * 0.5f, h * 0.5f), Vector2(w * 0.5f + 6, h * 0.5f), Vector2(w * 0.5f, h * 0.5f + 6), untextured));
+	cases.push_back(TriCase(r, "RasteriseTri/large", width, height,
+		Vector2(0, 0), Vector2(w - 1, 0), Vector2(0, h - 1), untextured));
+	cases.push_back(TriCase(r, "RasteriseTri/sliver", width, height,
+		Vector2(0, h * 0.5f), Vector2(w - 1, h * 0.5f + 1), Vector2(0, h * 0.5f + 3), untextured));
+
+	cases.push_back(TriCase(r, "RasteriseTri/large/blended", width, height,
+		Vector2(0, 0), Vector2(w - 1, 0), Vector2(0, h - 1), [&r]() {
+			r.SetTexture(NULL);
+			r.SetBlending();
+	}));
+
+	cases.push_back(TriCase(r, "RasteriseTri/large/area_fill", width, height,
+		Vector2(0, 0), Vector2(w - 1, 0), Vector2(0, h - 1), [&r]() {
+			r.SetTexture(NULL);
+			r.SetRasteriseMode(SoftwareRasteriser::RASTERISE_AREA);
+	}));
+	cases.back().batch = 1;
+
+	const PixelKernel::Type kernels[] = {
+		PixelKernel::KERNEL_SCALAR, PixelKernel::KERNEL_SSE2, PixelKernel::KERNEL_SSE42,
+		PixelKernel::KERNEL_AVX2, PixelKernel::KERNEL_AVX512
+	};
+	for (int i = 0; i < 5; ++i) {
+		PixelKernel::Type type = kernels[i];
+		if (!PixelKernel::IsSupported(type)) {
+			continue;
+		}
+		cases.push_back(TriCase(r, std::string("RasteriseTri/large/kernel_") + PixelKernel::Create(type).name, width, height,
+			Vector2(0, 0), Vector2(w - 1, 0), Vector2(0, h - 1), [&r, type]() {
+				r.SetTexture(NULL);
+				r.SetPixelKernel(type);
+		}));
+	}
+
+	for (int s = SoftwareRasteriser::SAMPLE_NEAREST; s <= SoftwareRasteriser::SAMPLE_MIPMAP_BILINEAR; ++s) {
+		SoftwareRasteriser::SampleState state = (SoftwareRasteriser::SampleState)s;
+
+		cases.push_back(TriCase(r, std::string("RasteriseTri/large/textured_") + SampleStateName(state), width, height,
+			Vector2(0, 0), Vector2(w - 1, 0), Vector2(0, h - 1), [&r, &texture, state]() {
+				r.SetTexture(&texture);
+				r.SetSampleState(state);
+		}));
+	}
+
+	//the whole texture squeezed into a few pixels, so the mipmapped states
+	//sample from the smaller levels
+	for (int s = SoftwareRasteriser::SAMPLE_NEAREST; s <= SoftwareRasteriser::SAMPLE_MIPMAP_BILINEAR; ++s) {
+		SoftwareRasteriser::SampleState state = (SoftwareRasteriser::SampleState)s;
+
+		cases.push_back(TriCase(r, std::string("RasteriseTri/minified/textured_") + SampleStateName(state), width, height,
+			Vector2(0, 0), Vector2(w / 16, 0), Vector2(0, h / 16), [&r, &texture, state]() {
+				r.SetTexture(&texture);
+				r.SetSampleState(state);
+		}));
+	}
+
+	//SutherlandHodgmanTri, given clip space vertices. It rasterises whatever
+	//it keeps, so the triangles are smaller than a pixel, and the time is all
+	//clipping and setup, whichever case it is.
+	struct ClipTri {
+		const char* name;
+		Vector4		v[3];
+	};
+	const float d = 0.0004f; //a quarter of a pixel across at 1280 wide
+	const ClipTri clipTris[] = {
+		{ "SutherlandHodgmanTri/inside",		{ Vector4(-d, -d, 0.5f, 1.0f), Vector4(d, -d, 0.5f, 1.0f), Vector4(-d, d, 0.5f, 1.0f) } },
+		{ "SutherlandHodgmanTri/partly_clipped",{ Vector4(-1.0f - d, -d, 0.5f, 1.0f), Vector4(-1.0f + d, -d, 0.5f, 1.0f), Vector4(-1.0f - d, d, 0.5f, 1.0f) } },
+		{ "SutherlandHodgmanTri/near_clipped",	{ Vector4(-d, -d, -2.0f, 1.0f), Vector4(d, -d, 0.5f, 1.0f), Vector4(-d, d, 0.5f, 1.0f) } },
+		{ "SutherlandHodgmanTri/fully_clipped",	{ Vector4(2.0f, 2.0f, 0.5f, 1.0f), Vector4(3.0f, 2.0f, 0.5f, 1.0f), Vector4(2.0f, 3.0f, 0.5f, 1.0f) } }
+	};
+	for (int i = 0; i < 4; ++i) {
+		ClipTri t = clipTris[i];
+
+		MicroCase m;
+		m.name			= t.name;
+		m.batch			= 256;
+		m.pixelsPerOp	= 0.0;
+		m.trisPerOp		= 1.0;
+		m.run = [&r, t](uint n) {
+			r.SetTexture(NULL);
+			for (uint j = 0; j < n; ++j) {
+				Vector4 v0 = t.v[0];
+				Vector4 v1 = t.v[1];
+				Vector4 v2 = t.v[2];
+				r.SutherlandHodgmanTri(v0, v1, v2);
+			}
+		};
+		cases.push_back(m);
+	}
+
+	//CohenSutherlandLine on its own, and RasteriseLine
+	struct ClipLine {
+		const char* name;
+		Vector4		a;
+		Vector4		b;
+	};
+	const ClipLine clipLines[] = {
+		{ "CohenSutherlandLine/inside",			Vector4(-0.5f, -0.5f, 0.5f, 1.0f), Vector4(0.5f, 0.5f, 0.5f, 1.0f) },
+		{ "CohenSutherlandLine/partly_clipped",	Vector4(-2.0f, -0.5f, 0.5f, 1.0f), Vector4(0.5f, 2.0f, 0.5f, 1.0f) },
+		{ "CohenSutherlandLine/fully_clipped",	Vector4(2.0f, 2.0f, 0.5f, 1.0f), Vector4(3.0f, 2.5f, 0.5f, 1.0f) }
+	};
+	for (int i = 0; i < 3; ++i) {
+		ClipLine l = clipLines[i];
+
+		MicroCase m;
+		m.name			= l.name;
+		m.batch			= 1024;
+		m.pixelsPerOp	= 0.0;
+		m.trisPerOp		= 0.0;
+		m.run = [&r, l](uint n) {
+			unsigned int accepted = 0;
+			for (uint j = 0; j < n; ++j) {
+				Vector4 a = l.a;
+				Vector4 b = l.b;
+				Colour ca, cb;
+				Vector3 ta, tb;
+				accepted += r.CohenSutherlandLine(a, b, ca, cb, ta, tb) ? 1 : 0;
+			}
+			sink = accepted;
+		};
+		cases.push_back(m);
+	}
+
+	const float lineLengths[] = { 16.0f, (float)max(width, height) - 1.0f };
+	const char* lineNames[] = { "RasteriseLine/short", "RasteriseLine/long" };
+	for (int i = 0; i < 2; ++i) {
+		float length = lineLengths[i];
+		Vector4 a(ToNDC(0, width), ToNDC(0, height), 0.5f, 1.0f);
+		Vector4 b(ToNDC(min(length, w - 1), width), ToNDC(min(length, h - 1), height), 0.5f, 1.0f);
+
+		MicroCase m;
+		m.name			= lineNames[i];
+		m.batch			= 64;
+		m.pixelsPerOp	= max(min(length, w - 1), min(length, h - 1));
+		m.trisPerOp		= 0.0;
+		m.run = [&r, a, b](uint n) {
+			for (uint j = 0; j < n; ++j) {
+				r.RasteriseLine(a, b, Colour(255, 255, 255, 255), Colour(255, 255, 255, 255));
+			}
+		};
+		cases.push_back(m);
+	}
+
+	//texture sampling, at a scattered set of coordinates
+	{
+		std::vector<Vector3> coords(4096);
+		unsigned int seed = 12345;
+		for (uint i = 0; i < coords.size(); ++i) {
+			seed = seed * 1664525u + 1013904223u;
+			float u = (seed >> 8) / 16777216.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float v = (seed >> 8) / 16777216.0f;
+			coords[i] = Vector3(u, v, 1.0f);
+		}
+
+		MicroCase m;
+		m.name			= "BilinearTexSample/scattered";
+		m.batch			= (uint)coords.size();
+		m.pixelsPerOp	= 1.0;
+		m.trisPerOp		= 0.0;
+		m.run = [&texture, coords](uint n) {
+			unsigned int total = 0;
+			for (uint j = 0; j < n; ++j) {
+				total += texture.BilinearTexSample(coords[j % coords.size()]).c;
+			}
+			sink = total;
+		};
+		cases.push_back(m);
+
+		m.name			= "BilinearTexSampleBatch/scattered";
+		m.run = [&texture, coords](uint n) {
+			std::vector<Colour> out(coords.size());
+			unsigned int total = 0;
+			for (uint j = 0; j < n; j += (uint)coords.size()) {
+				uint count = min(n - j, (uint)coords.size());
+				texture.BilinearTexSampleBatch(&coords[0], count, &out[0]);
+				total += out[count - 1].c;
+			}
+			sink = total;
+		};
+		cases.push_back(m);
+	}
+
+	//texture sampling along the rows of a screen sized patch, one texel per
+	//pixel, with the texture turned to different angles. Turned a quarter of
+	//the way round, each row walks down a column of texels, so every fetch of
+	//a row by row texture is on a new cache line.
+	{
+		const uint walkSize = 2048;
+		const uint patchSize = 1024;
+		const float angles[] = { 0.0f, 45.0f, 90.0f };
+		const char* angleNames[] = { "axis_aligned", "rotated_45", "rotated_90" };
+		const Texture::TexelLayout layouts[] = { Texture::TEXELS_LINEAR, Texture::TEXELS_TILED };
+		const char* layoutNames[] = { "linear", "tiled" };
+
+		for (int l = 0; l < 2; ++l) {
+			std::shared_ptr<BenchTexture> t(new BenchTexture(walkSize));
+			t->SetTexelLayout(layouts[l]);
+
+			for (int a = 0; a < 3; ++a) {
+				float radians = (float)DegToRad(angles[a]);
+				//texture space step for one pixel across, and one pixel down
+				Vector3 across(cos(radians) / walkSize, sin(radians) / walkSize, 0.0f);
+				Vector3 down(-sin(radians) / walkSize, cos(radians) / walkSize, 0.0f);
+				//turned about the middle of the texture
+				Vector3 origin = Vector3(0.5f, 0.5f, 1.0f) - (across + down) * (patchSize * 0.5f);
+
+				MicroCase m;
+				m.name			= std::string("NearestTexSample/") + angleNames[a] + "/" + layoutNames[l];
+				m.batch			= patchSize * patchSize;
+				m.pixelsPerOp	= 1.0;
+				m.trisPerOp		= 0.0;
+				m.run = [t, origin, across, down, patchSize](uint n) {
+					unsigned int total = 0;
+					Vector3 row = origin;
+					Vector3 coords = row;
+					for (uint j = 0; j < n; ++j) {
+						if (j % patchSize == 0) {
+							row = (j % (patchSize * patchSize) == 0) ? origin : row + down;
+							coords = row;
+						}
+						total += t->NearestTexSample(coords).c;
+						coords += across;
+					}
+					sink = total;
+				};
+				cases.push_back(m);
+
+				m.name			= std::string("BilinearTexSample/") + angleNames[a] + "/" + layoutNames[l];
+				m.batch			= patchSize * patchSize;
+				m.pixelsPerOp	= 1.0;
+				m.trisPerOp		= 0.0;
+				m.run = [t, origin, across, down, patchSize](uint n) {
+					unsigned int total = 0;
+					Vector3 row = origin;
+					Vector3 coords = row;
+					for (uint j = 0; j < n; ++j) {
+						if (j % patchSize == 0) {
+							row = (j % (patchSize * patchSize) == 0) ? origin : row + down;
+							coords = row;
+						}
+						total += t->BilinearTexSample(coords).c;
+						coords += across;
+					}
+					sink = total;
+				};
+				cases.push_back(m);
+			}
+		}
+	}
+
+	const uint mipSizes[] = { 256, 1024 };
+	for (int i = 0; i < 2; ++i) {
+		uint size = mipSizes[i];
+		std::shared_ptr<BenchTexture> t(new BenchTexture(size));
+
+		std::ostringstream name;
+		name << "CreateMipMaps/" << size << "x" << size;
+
+		MicroCase m;
+		m.name			= name.str();
+		m.batch			= 1;
+		m.pixelsPerOp	= (double)size * size;
+		m.trisPerOp		= 0.0;
+		m.run = [t](uint n) {
+			for (uint j = 0; j < n; ++j) {
+				t->RebuildMipMaps();
+			}
+		};
+		cases.push_back(m);
+	}
+
+	//the vertex stage, an operation being one vertex
+	{
+		std::shared_ptr<std::vector<Vector4> > positions(new std::vector<Vector4>(4096));
+		unsigned int seed = 54321;
+		for (uint i = 0; i < positions->size(); ++i) {
+			float p[3];
+			for (int j = 0; j < 3; ++j) {
+				seed = seed * 1664525u + 1013904223u;
+				p[j] = ((seed >> 8) / 16777216.0f) * 40.0f - 20.0f;
+			}
+			(*positions)[i] = Vector4(p[0], p[1], p[2] - 30.0f, 1.0f);
+		}
+		Matrix4 mvp = Matrix4::Perspective(1.0f, 500.0f, (float)width / height, 45.0f) *
+			Matrix4::Rotation(30.0f, Vector3(0, 1, 0));
+
+		const VertexTransform::Type transforms[] = {
+			VertexTransform::TRANSFORM_SCALAR, VertexTransform::TRANSFORM_SSE2, VertexTransform::TRANSFORM_AVX2
+		};
+		for (int i = 0; i < 3; ++i) {
+			if (!VertexTransform::IsSupported(transforms[i])) {
+				continue;
+			}
+			VertexTransform transform = VertexTransform::Create(transforms[i]);
+			std::shared_ptr<ClipSpaceBuffer> out(new ClipSpaceBuffer());
+
+			MicroCase m;
+			m.name			= std::string("TransformVertices/") + transform.name;
+			m.batch			= (uint)positions->size();
+			m.pixelsPerOp	= 0.0;
+			m.trisPerOp		= 0.0;
+			m.run = [transform, positions, out, mvp](uint n) {
+				for (uint j = 0; j < n; j += (uint)positions->size()) {
+					transform.Transform(mvp, &(*positions)[0], (uint)positions->size(), *out);
+				}
+				sink = out->outcodes[0];
+			};
+			cases.push_back(m);
+		}
+	}
+
+	{
+		MicroCase m;
+		m.name			= "ClearBuffers";
+		m.batch			= 1;
+		m.pixelsPerOp	= (double)width * height;
+		m.trisPerOp		= 0.0;
+		m.run = [&r](uint n) {
+			for (uint j = 0; j < n; ++j) {
+				r.ClearBuffers();
+			}
+		};
+		cases.push_back(m);
+	}
+	return cases;
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	RUNNING		********************************
+*///////////////////////////////////////////////////////////
+
+static MicroResult RunCase(const MicroCase &m, double minSeconds, CacheMissCounter &misses) {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	m.run(m.batch); //warm up caches and lazily created state
+
+	uint64_t ops = 0;
+	misses.Start();
+	Clock::time_point start = Clock::now();
+	double elapsed = 0.0;
+
+	while (elapsed < minSeconds) {
+		m.run(m.batch);
+		ops += m.batch;
+		elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+	uint64_t missCount = misses.Stop();
+
+	MicroResult result;
+	result.name				= m.name;
+	result.ops				= ops;
+	result.nsPerOp			= (elapsed * 1e9) / ops;
+	result.mPixelsPerSec	= (m.pixelsPerOp * ops) / (elapsed * 1e6);
+	result.trisPerSec		= (m.trisPerOp * ops) / elapsed;
+	result.cacheMissesPerOp	= misses.IsAvailable() ? (double)missCount / ops : -1.0;
+	return result;
+}
+
+static void PrintResults(const std::vector<MicroResult> &results, const std::string &format,
+	const char* kernel, uint width, uint height) {
+
+	if (format == "csv") {
+		std::cout << "name,ops,ns_per_op,mpixels_per_s,tris_per_s,cache_misses_per_op" << std::endl;
+		for (uint i = 0; i < results.size(); ++i) {
+			const MicroResult &r = results[i];
+			std::cout << r.name << "," << r.ops << "," << r.nsPerOp << "," << r.mPixelsPerSec << "," << r.trisPerSec << ",";
+			if (r.cacheMissesPerOp >= 0.0) {
+				std::cout << r.cacheMissesPerOp;
+			}
+			std::cout << std::endl;
+		}
+	}
+	else if (format == "json") {
+		std::cout << "{" << std::endl;
+		std::cout << "\t\"kernel\": \"" << kernel << "\"," << std::endl;
+		std::cout << "\t\"width\": " << width << "," << std::endl;
+		std::cout << "\t\"height\": " << height << "," << std::endl;
+		std::cout << "\t\"results\": [" << std::endl;
+		for (uint i = 0; i < results.size(); ++i) {
+			const MicroResult &r = results[i];
+			std::cout << "\t\t{ \"name\": \"" << r.name << "\", \"ops\": " << r.ops
+				<< ", \"ns_per_op\": " << r.nsPerOp
+				<< ", \"mpixels_per_s\": " << r.mPixelsPerSec
+				<< ", \"tris_per_s\": " << r.trisPerSec
+				<< ", \"cache_misses_per_op\": ";
+			if (r.cacheMissesPerOp >= 0.0) {
+				std::cout << r.cacheMissesPerOp;
+			}
+			else {
+				std::cout << "null";
+			}
+			std::cout << " }"
+				<< ((i + 1) < results.size() ? "," : "") << std::endl;
+		}
+		std::cout << "\t]" << std::endl;
+		std::cout << "}" << std::endl;
+	}
+	else {
+		std::cout << "default kernel " << kernel << ", " << width << "x" << height << std::endl;
+		if (!results.empty() && results[0].cacheMissesPerOp < 0.0) {
+			std::cout << "(no cache miss counter here)" << std::endl;
+		}
+		for (uint i = 0; i < results.size(); ++i) {
+			const MicroResult &r = results[i];
+			std::cout << r.name << ": " << r.nsPerOp << " ns/op";
+			if (r.mPixelsPerSec > 0.0) {
+				std::cout << ", " << r.mPixelsPerSec << " Mpixels/s";
+			}
+			if (r.trisPerSec > 0.0) {
+				std::cout << ", " << r.trisPerSec << " tris/s";
+			}
+			if (r.cacheMissesPerOp >= 0.0) {
+				std::cout << ", " << r.cacheMissesPerOp << " cache misses/op";
+			}
+			std::cout << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	uint		width		= 1280;
+	uint		height		= 960;
+	double		minSeconds	= 0.25;
+	const char*	filter		= NULL;
+	std::string	format		= "text";
+
+	for (int i = 1; i < argc; ++i) {
+		bool hasValue = (i + 1) < argc;
+
+		if (!strcmp(argv[i], "--width") && hasValue) {
+			width = max(atoi(argv[++i]), 16);
+		}
+		else if (!strcmp(argv[i], "--height") && hasValue) {
+			height = max(atoi(argv[++i]), 16);
+		}
+		else if (!strcmp(argv[i], "--time") && hasValue) {
+			minSeconds = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--filter") && hasValue) {
+			filter = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--format") && hasValue) {
+			format = argv[++i];
+		}
+		else {
+			std::cerr << "unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	std::streambuf* coutBuffer = std::cout.rdbuf();
+	std::cout.rdbuf(std::cerr.rdbuf()); //texture loading chatter stays out of the results
+
+	BenchRasteriser r(width, height);
+	BenchTexture texture(256);
+
+	const char* defaultKernel = r.GetPixelKernelName();
+	std::vector<MicroCase> cases = BuildCases(r, texture, width, height);
+	std::vector<MicroResult> results;
+	CacheMissCounter misses;
+
+	for (uint i = 0; i < cases.size(); ++i) {
+		if (filter && cases[i].name.find(filter) == std::string::npos) {
+			continue;
+		}
+		//every case starts from the same state
+		r.SetRasteriseMode(SoftwareRasteriser::RASTERISE_EDGE);
+		r.SetPixelKernel(PixelKernel::CreateBest().type);
+		r.SetSampleState(SoftwareRasteriser::SAMPLE_NEAREST);
+		r.SetTexture(NULL);
+		r.ClearBuffers();
+
+		results.push_back(RunCase(cases[i], minSeconds, misses));
+	}
+
+	std::cout.rdbuf(coutBuffer);
+	PrintResults(results, format, defaultKernel, width, height);
+	return 0;
+}
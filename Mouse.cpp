@@ -1,13 +1,16 @@
 #include "Mouse.h"
 
+#include <cstring>
+
 Mouse* Mouse::instance = 0;
 
+#ifdef WINDOW_WIN32
 Mouse::Mouse(HWND &hwnd)	{
-	ZeroMemory( buttons,	 sizeof(bool) * MOUSE_MAX );
-	ZeroMemory( holdButtons, sizeof(bool) * MOUSE_MAX );
+	memset( buttons,	   0, sizeof(bool) * MOUSE_MAX );
+	memset( holdButtons,   0, sizeof(bool) * MOUSE_MAX );
 
-	ZeroMemory( doubleClicks,  sizeof(bool)  * MOUSE_MAX );
-	ZeroMemory( lastClickTime, sizeof(float) * MOUSE_MAX );
+	memset( doubleClicks,  0, sizeof(bool)  * MOUSE_MAX );
+	memset( lastClickTime, 0, sizeof(float) * MOUSE_MAX );
 
 	lastWheel   = 0;
 	frameWheel  = 0;
@@ -24,11 +27,30 @@ Mouse::Mouse(HWND &hwnd)	{
 void Mouse::Initialise(HWND &hwnd) {
 	instance = new Mouse(hwnd);
 }
+#else
+Mouse::Mouse()	{
+	memset( buttons,	   0, sizeof(bool) * MOUSE_MAX );
+	memset( holdButtons,   0, sizeof(bool) * MOUSE_MAX );
+
+	memset( doubleClicks,  0, sizeof(bool)  * MOUSE_MAX );
+	memset( lastClickTime, 0, sizeof(float) * MOUSE_MAX );
+
+	lastWheel   = 0;
+	frameWheel  = 0;
+	sensitivity = 0.07f;
+	clickLimit  = 200.0f;
+}
+
+void Mouse::Initialise() {
+	instance = new Mouse();
+}
+#endif
 
 void Mouse::Destroy() {
 	delete instance;
 }
 
+#ifdef WINDOW_WIN32
 void Mouse::Update(RAWINPUT* raw)	{
 	if(isAwake)	{
 		/*
@@ -101,6 +123,7 @@ void Mouse::Update(RAWINPUT* raw)	{
 		}
 	}
 }
+#endif
 
 /*
 Sets the mouse sensitivity (higher = mouse pointer moves more!)
@@ -132,8 +155,8 @@ movement or buttons until it receives a Wake()
 */
 void Mouse::Sleep()	{
 	isAwake = false;	//Bye bye for now
-	ZeroMemory(holdButtons,  MOUSE_MAX * sizeof(bool) );
-	ZeroMemory(buttons,		MOUSE_MAX * sizeof(bool) );
+	memset(holdButtons, 0, MOUSE_MAX * sizeof(bool) );
+	memset(buttons,		0, MOUSE_MAX * sizeof(bool) );
 }
 
 /*
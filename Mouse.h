@@ -60,17 +60,27 @@ public:
 	void	SetMouseSensitivity(float amount);
 
 protected:
+#ifdef WINDOW_WIN32
 	Mouse(HWND &hwnd);
+#else
+	Mouse();
+#endif
 	~Mouse(void){}
 
+#ifdef WINDOW_WIN32
 	static void Initialise(HWND &hwnd);
+#else
+	static void Initialise();
+#endif
 	static void Destroy();
 
 	static Mouse* instance;
 
+#ifdef WINDOW_WIN32
 	//Internal function that updates the mouse variables from a 
 	//raw input 'packet'
 	virtual void	Update(RAWINPUT* raw);
+#endif
 	//Updates the holdButtons array. Call once per frame!
 	virtual void	UpdateHolds();
 	//Sends the mouse to sleep (i.e window has been alt-tabbed away etc)
@@ -0,0 +1,348 @@
+#include "OBJLoader.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+static const uint NO_INDEX = 0xFFFFFFFF;
+
+//one corner of a triangle, as indices into the whole file's positions and
+//texture coordinates
+struct OBJCorner {
+	uint	position;
+	uint	texCoord;
+};
+
+struct OBJChunk {
+	const char*	begin;
+	const char*	end;
+
+	uint	numPositions;	//how many v and vt lines the chunk has...
+	uint	numTexCoords;
+	uint	firstPosition;	//...and how many come before it
+	uint	firstTexCoord;
+
+	std::vector<OBJCorner>	corners;	//3 per triangle
+};
+
+/*//////////////////////////////////////////////////////////
+//**********	PARSING	************************************
+*///////////////////////////////////////////////////////////
+
+static inline bool IsSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && IsSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+//strtod is slow, and reads commas as decimal points in some locales, so
+//this handles the plain [-]digits[.digits][e[-]digits] OBJ files use
+static bool ParseFloat(const char* &p, const char* end, float &out) {
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa	= 0;
+	int exponent		= 0;
+	int digits			= 0;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+		if (mantissa < 100000000000000000ull) {
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+		else {
+			exponent++;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+			if (mantissa < 100000000000000000ull) {
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+		}
+	}
+	if (!digits) {
+		return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negativeExponent = (*e == '-');
+			++e;
+		}
+		int power = 0;
+		const char* start = e;
+		for (; e < end && *e >= '0' && *e <= '9'; ++e) {
+			power = min(power * 10 + (*e - '0'), 10000);
+		}
+		if (e != start) {
+			exponent += negativeExponent ? -power : power;
+			p = e;
+		}
+	}
+
+	double value = (double)mantissa;
+	if (exponent) {
+		value = (exponent < 0) ? value / pow(10.0, -exponent) : value * pow(10.0, exponent);
+	}
+	out = (float)(negative ? -value : value);
+	return true;
+}
+
+static bool ParseInt(const char* &p, const char* end, int &out) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+	const char* start = p;
+	int64_t value = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+		value = min(value * 10 + (*p - '0'), (int64_t)0x7FFFFFFF);
+	}
+	out = (int)(negative ? -value : value);
+	return p != start;
+}
+
+//OBJ indices count from 1, or back from the last one read if negative.
+//Anything outside the file's count of them is NO_INDEX.
+static uint ResolveIndex(int index, uint readSoFar, uint total) {
+	int64_t i = (index > 0) ? (int64_t)index - 1 : (int64_t)readSoFar + index;
+	return (index != 0 && i >= 0 && i < (int64_t)total) ? (uint)i : NO_INDEX;
+}
+
+static inline bool LineStartsWith(const char* p, const char* end, const char* keyword, size_t length) {
+	return (size_t)(end - p) > length && !memcmp(p, keyword, length) && IsSpace(p[length]);
+}
+
+//the first pass only counts vertices, so every chunk knows where its own go
+//before any are parsed
+static void CountChunk(OBJChunk &c) {
+	c.numPositions = 0;
+	c.numTexCoords = 0;
+
+	for (const char* line = c.begin; line < c.end;) {
+		const char* next = (const char*)memchr(line, '\n', c.end - line);
+		next = next ? next + 1 : c.end;
+
+		const char* p = SkipSpaces(line, next);
+		if (LineStartsWith(p, next, "v", 1)) {
+			c.numPositions++;
+		}
+		else if (LineStartsWith(p, next, "vt", 2)) {
+			c.numTexCoords++;
+		}
+		line = next;
+	}
+}
+
+static void ParseChunk(OBJChunk &c, uint totalPositions, uint totalTexCoords,
+	Vector4* positions, Colour* colours, Vector2* texCoords) {
+	uint position	= c.firstPosition;
+	uint texCoord	= c.firstTexCoord;
+
+	c.corners.clear();
+
+	std::vector<OBJCorner> face;
+
+	for (const char* line = c.begin; line < c.end;) {
+		const char* next = (const char*)memchr(line, '\n', c.end - line);
+		next = next ? next + 1 : c.end;
+
+		const char* p = SkipSpaces(line, next);
+
+		if (LineStartsWith(p, next, "v", 1)) {
+			p += 1;
+			Vector4 &v = positions[position];
+			float values[4];
+			int count = 0;
+			while (count < 4 && ParseFloat(p, next, values[count])) {
+				count++;
+			}
+			v = Vector4(count > 0 ? values[0] : 0.0f, count > 1 ? values[1] : 0.0f, count > 2 ? values[2] : 0.0f, 1.0f);
+
+			float rgb[3];
+			//x y z r g b - a 4th value on its own is w, which is left at 1
+			if (count == 4) {
+				rgb[0] = values[3];
+				if (ParseFloat(p, next, rgb[1]) && ParseFloat(p, next, rgb[2])) {
+					colours[position] = Colour((unsigned char)(min(max(rgb[0], 0.0f), 1.0f) * 255.0f + 0.5f),
+						(unsigned char)(min(max(rgb[1], 0.0f), 1.0f) * 255.0f + 0.5f),
+						(unsigned char)(min(max(rgb[2], 0.0f), 1.0f) * 255.0f + 0.5f), 255);
+				}
+			}
+			position++;
+		}
+		else if (LineStartsWith(p, next, "vt", 2)) {
+			p += 2;
+			Vector2 &t = texCoords[texCoord];
+			t = Vector2(0.0f, 0.0f);
+			ParseFloat(p, next, t.x);
+			ParseFloat(p, next, t.y);
+			texCoord++;
+		}
+		else if (LineStartsWith(p, next, "f", 1)) {
+			p += 1;
+			face.clear();
+			bool valid = true;
+
+			for (p = SkipSpaces(p, next); p < next && *p != '\n' && *p != '#'; p = SkipSpaces(p, next)) {
+				int v = 0;
+				int vt = 0;
+				if (!ParseInt(p, next, v)) {
+					valid = false;
+					break;
+				}
+				OBJCorner corner;
+				corner.position = ResolveIndex(v, position, totalPositions);
+				corner.texCoord = NO_INDEX;
+				if (p < next && *p == '/') {
+					++p;
+					if (ParseInt(p, next, vt)) {
+						corner.texCoord = ResolveIndex(vt, texCoord, totalTexCoords);
+						valid = valid && corner.texCoord != NO_INDEX;
+					}
+					if (p < next && *p == '/') { // the normal, which meshes don't have
+						int vn;
+						++p;
+						ParseInt(p, next, vn);
+					}
+				}
+				valid = valid && corner.position != NO_INDEX;
+				face.push_back(corner);
+
+				while (p < next && !IsSpace(*p) && *p != '\n') { // anything else stuck to the corner
+					++p;
+				}
+			}
+
+			//a fan, the same way RasteriseTriFanMesh splits them up
+			if (valid) {
+				for (size_t i = 2; i < face.size(); ++i) {
+					c.corners.push_back(face[0]);
+					c.corners.push_back(face[i - 1]);
+					c.corners.push_back(face[i]);
+				}
+			}
+		}
+		line = next;
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	LOAD	************************************
+*///////////////////////////////////////////////////////////
+
+Mesh* OBJLoader::Load(const string &filename, uint threads) {
+	MappedFile* file = MappedFile::Open(filename);
+	if (!file) {
+		return NULL;
+	}
+
+	const char* text	= (const char*)file->GetData();
+	const char* textEnd	= text + file->GetSize();
+
+	//cut at the first line break after every CHUNK_BYTES
+	std::vector<OBJChunk> chunks;
+	for (const char* begin = text; begin < textEnd;) {
+		const char* end = begin + min(CHUNK_BYTES, (size_t)(textEnd - begin));
+		const char* lineEnd = (end < textEnd) ? (const char*)memchr(end, '\n', textEnd - end) : NULL;
+		end = lineEnd ? lineEnd + 1 : textEnd;
+
+		OBJChunk c = OBJChunk();
+		c.begin	= begin;
+		c.end	= end;
+		chunks.push_back(c);
+		begin = end;
+	}
+
+	WorkerPool pool(min(threads ? threads : WorkerPool::DefaultThreadCount(), (uint)chunks.size()));
+
+	pool.Run((uint)chunks.size(), [&](uint i) { CountChunk(chunks[i]); });
+
+	uint totalPositions = 0;
+	uint totalTexCoords = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		chunks[i].firstPosition = totalPositions;
+		chunks[i].firstTexCoord = totalTexCoords;
+		totalPositions += chunks[i].numPositions;
+		totalTexCoords += chunks[i].numTexCoords;
+	}
+
+	std::vector<Vector4> positions(totalPositions);
+	std::vector<Colour> colours(totalPositions, Colour(255, 255, 255, 255));
+	std::vector<Vector2> texCoords(totalTexCoords);
+
+	pool.Run((uint)chunks.size(), [&](uint i) {
+		ParseChunk(chunks[i], totalPositions, totalTexCoords, positions.data(), colours.data(), texCoords.data());
+	});
+
+	delete file;
+
+	//Every distinct (v, vt) pair becomes one vertex, numbered in the order
+	//they're first used. Positions are already small dense numbers, so rather
+	//than hashing the pair, each position keeps a list of the vertices made
+	//from it - almost always just one or two long.
+	size_t numCorners = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		numCorners += chunks[i].corners.size();
+	}
+
+	std::vector<uint> firstWithPosition(totalPositions, NO_INDEX);
+	std::vector<uint> nextWithPosition;
+	std::vector<OBJCorner> firstUse;
+	std::vector<uint> indices;
+	nextWithPosition.reserve(totalPositions);
+	firstUse.reserve(totalPositions);
+	indices.reserve(numCorners);
+
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		const std::vector<OBJCorner> &corners = chunks[i].corners;
+		for (size_t j = 0; j < corners.size(); ++j) {
+			const OBJCorner &c = corners[j];
+
+			uint vertex = firstWithPosition[c.position];
+			while (vertex != NO_INDEX && firstUse[vertex].texCoord != c.texCoord) {
+				vertex = nextWithPosition[vertex];
+			}
+			if (vertex == NO_INDEX) {
+				vertex = (uint)firstUse.size();
+				firstUse.push_back(c);
+				nextWithPosition.push_back(firstWithPosition[c.position]);
+				firstWithPosition[c.position] = vertex;
+			}
+			indices.push_back(vertex);
+		}
+		std::vector<OBJCorner>().swap(chunks[i].corners);
+	}
+
+	Mesh* m				= new Mesh();
+	m->type				= PRIMITIVE_TRIANGLES;
+	m->numVertices		= (uint)firstUse.size();
+	m->vertices			= new Vector4[m->numVertices];
+	m->colours			= new Colour[m->numVertices];
+	m->textureCoords	= new Vector2[m->numVertices];
+
+	for (uint i = 0; i < m->numVertices; ++i) {
+		const OBJCorner &c = firstUse[i];
+		m->vertices[i]		= positions[c.position];
+		m->colours[i]		= colours[c.position];
+		m->textureCoords[i]	= (c.texCoord != NO_INDEX) ? texCoords[c.texCoord] : Vector2(0.0f, 0.0f);
+	}
+	m->SetIndices(indices);
+	m->UpdateOpaque();
+	return m;
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+Class:OBJLoader
+Implements:
+Author:Geoff Whitehead
+Description:Reads Wavefront .obj files into indexed triangle meshes. Faces
+are split into fans of triangles, and every distinct pair of position and
+texture coordinate indices their corners use becomes one welded vertex, so
+nothing is duplicated and nothing needs welding afterwards.
+
+Positions can carry a colour after them (v x y z r g b, with each channel
+from 0 to 1), as MeshLab and ZBrush write them; anything without one is
+white. Normals, groups and materials are skipped over.
+
+Big files are parsed in parallel: the file is mapped, cut into chunks at
+line breaks, and each chunk parsed on a thread of its own, straight into its
+place in the shared position and texture coordinate arrays.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Mesh.h"
+
+class OBJLoader {
+public:
+	//NULL if the file can't be opened. threads of 0 uses one per hardware
+	//thread.
+	static Mesh*	Load(const string &filename, uint threads = 0);
+
+	//files are cut into chunks of about this many bytes
+	static const size_t CHUNK_BYTES = 1 << 20;
+};
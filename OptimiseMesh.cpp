@@ -0,0 +1,95 @@
+#include "MeshOptimiser.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+
+/*
+Welds a mesh, reorders it with MeshOptimiser, reports what that did to its
+ACMR, ATVR and overdraw, and saves it as a .srmesh ready to be mapped:
+
+optimisemesh input.mesh|input.obj|input.srmesh [output.srmesh] [--threshold T] [--no-overdraw]
+
+The output defaults to the input with its extension swapped for .srmesh (so
+has to be given for .srmesh inputs). --threshold is how much ACMR the
+overdraw pass can give up, 1.05 by default; --no-overdraw skips it.
+*/
+
+static void PrintStats(const char* name, const MeshStats &s) {
+	std::cout << name << "ACMR " << s.acmr << ", ATVR " << s.atvr << ", overdraw " << s.overdraw << std::endl;
+}
+
+int main(int argc, char** argv) {
+	const char* input	= NULL;
+	const char* output	= NULL;
+	float threshold		= 1.05f;
+	bool overdraw		= true;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--threshold") && (i + 1) < argc) {
+			threshold = (float)atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--no-overdraw")) {
+			overdraw = false;
+		}
+		else if (!input) {
+			input = argv[i];
+		}
+		else if (!output) {
+			output = argv[i];
+		}
+		else {
+			std::cerr << "unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+	if (!input) {
+		std::cerr << "optimisemesh input.mesh|input.obj|input.srmesh [output.srmesh] [--threshold T] [--no-overdraw]" << std::endl;
+		return 1;
+	}
+
+	string outName = output ? output : string(input);
+	if (!output) {
+		size_t dot = outName.find_last_of('.');
+		outName = outName.substr(0, (dot == string::npos) ? outName.size() : dot) + ".srmesh";
+		if (outName == input) {
+			std::cerr << "give an output name to replace " << input << std::endl;
+			return 1;
+		}
+	}
+
+	Mesh* m = Mesh::LoadMeshFile(input, true);
+	if (!m || m->GetType() != PRIMITIVE_TRIANGLES || !m->IsIndexed()) {
+		std::cerr << "couldn't load a triangle mesh from " << input << std::endl;
+		delete m;
+		return 1;
+	}
+
+	std::cout << m->GetNumVertices() << " vertices, " << (m->GetNumIndices() / 3) << " triangles" << std::endl;
+	PrintStats("before:            ", MeshOptimiser::Analyse(m));
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	MeshOptimiser::OptimiseVertexCache(m);
+	std::chrono::duration<double, std::milli> cacheTime = std::chrono::high_resolution_clock::now() - start;
+	PrintStats("vertex cache:      ", MeshOptimiser::Analyse(m));
+
+	if (overdraw) {
+		start = std::chrono::high_resolution_clock::now();
+		MeshOptimiser::OptimiseOverdraw(m, threshold);
+		std::chrono::duration<double, std::milli> overdrawTime = std::chrono::high_resolution_clock::now() - start;
+		PrintStats("overdraw:          ", MeshOptimiser::Analyse(m));
+		std::cout << "(vertex cache " << cacheTime.count() << " ms, overdraw " << overdrawTime.count() << " ms)" << std::endl;
+	}
+	MeshOptimiser::OptimiseVertexFetch(m);
+
+	if (!m->SaveBinaryMeshFile(outName)) {
+		std::cerr << "couldn't write " << outName << std::endl;
+		delete m;
+		return 1;
+	}
+	std::cout << "saved " << outName << std::endl;
+
+	delete m;
+	return 0;
+}
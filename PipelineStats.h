@@ -0,0 +1,92 @@
+/******************************************************************************
+Class:PipelineStats
+Implements:
+Author:Geoff Whitehead
+Description:Counts of the work each stage of the rasteriser did, much like a
+GPU's pipeline statistics query: vertices transformed, primitives clipped
+and culled, depth tests passed and failed, and pixels blended.
+
+Counting only happens in builds with SR_PIPELINE_STATS defined. Everywhere
+else the PIPELINE_STAT lines compile to nothing, and the counts stay at 0.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Common.h"
+
+#ifdef SR_PIPELINE_STATS
+#define PIPELINE_STAT(x) (x)
+static const bool PIPELINE_STATS_ENABLED = true;
+#else
+#define PIPELINE_STAT(x) ((void)0)
+static const bool PIPELINE_STATS_ENABLED = false;
+#endif
+
+struct PipelineStats {
+	uint	verticesTransformed;
+
+	uint	meshletsSubmitted;
+	uint	meshletsFrustumCulled;	//entirely outside one clip plane, so never transformed
+	uint	meshletsBackFacing;		//seen from inside their back facing cone, ditto
+
+	uint	pointsSubmitted;
+	uint	linesSubmitted;
+	uint	linesClipCulled;		//entirely outside the clip volume
+	uint	trianglesSubmitted;		//assembled from a mesh
+	uint	trianglesTrivialAccepted;	//entirely inside the clip volume, so never clipped
+	uint	trianglesTrivialRejected;	//entirely outside one clip plane
+	uint	trianglesGuardBanded;	//crossed the edge of the screen, but not the guard band, so never clipped
+	uint	trianglesClipped;		//straddled a plane, so went through SutherlandHodgmanTri
+	uint	trianglesClipCulled;	//had nothing left once clipped
+	uint	trianglesEmitted;		//what the clipper passed on to RasteriseTri
+	uint	trianglesBackFacing;
+
+	uint	depthTestsPassed;
+	uint	depthTestsFailed;		//blocks Hi-Z skips are never tested at all
+	uint	pixelsBlended;			//pixels written by the fills, blended or not
+
+	PipelineStats() {
+		Reset();
+	}
+
+	void Reset() {
+		verticesTransformed = 0;
+		meshletsSubmitted	= meshletsFrustumCulled = meshletsBackFacing = 0;
+		pointsSubmitted		= linesSubmitted	= linesClipCulled		= 0;
+		trianglesSubmitted	= trianglesClipped	= trianglesClipCulled	= 0;
+		trianglesTrivialAccepted = trianglesTrivialRejected = trianglesGuardBanded = 0;
+		trianglesEmitted	= trianglesBackFacing = 0;
+		depthTestsPassed	= depthTestsFailed	= pixelsBlended			= 0;
+	}
+
+	void Add(const PipelineStats &s) {
+		verticesTransformed += s.verticesTransformed;
+		meshletsSubmitted	+= s.meshletsSubmitted;
+		meshletsFrustumCulled += s.meshletsFrustumCulled;
+		meshletsBackFacing	+= s.meshletsBackFacing;
+		pointsSubmitted		+= s.pointsSubmitted;
+		linesSubmitted		+= s.linesSubmitted;
+		linesClipCulled		+= s.linesClipCulled;
+		trianglesSubmitted	+= s.trianglesSubmitted;
+		trianglesTrivialAccepted += s.trianglesTrivialAccepted;
+		trianglesTrivialRejected += s.trianglesTrivialRejected;
+		trianglesGuardBanded += s.trianglesGuardBanded;
+		trianglesClipped	+= s.trianglesClipped;
+		trianglesClipCulled += s.trianglesClipCulled;
+		trianglesEmitted	+= s.trianglesEmitted;
+		trianglesBackFacing += s.trianglesBackFacing;
+		depthTestsPassed	+= s.depthTestsPassed;
+		depthTestsFailed	+= s.depthTestsFailed;
+		pixelsBlended		+= s.pixelsBlended;
+	}
+
+	//how many bits of a PixelBlock lane mask are set
+	static inline uint CountLanes(uint mask) {
+		uint count = 0;
+		for (; mask; mask &= mask - 1) {
+			++count;
+		}
+		return count;
+	}
+};
@@ -0,0 +1,298 @@
+#include "PixelKernel.h"
+#include "Common.h"
+
+#include <cstring>
+
+#ifdef PIXEL_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+/*//////////////////////////////////////////////////////////
+//**********	KERNEL SELECTION	************************
+*///////////////////////////////////////////////////////////
+
+bool PixelKernel::IsSupported(Type type) {
+	switch (type) {
+	case KERNEL_SCALAR:
+		return true;
+#ifdef PIXEL_KERNEL_SSE2
+	case KERNEL_SSE2:
+		return CPUFeatures::HasSSE2();
+#endif
+#ifdef PIXEL_KERNEL_SSE42
+	case KERNEL_SSE42:
+		return CPUFeatures::HasSSE42();
+#endif
+#ifdef PIXEL_KERNEL_AVX2
+	case KERNEL_AVX2:
+		return CPUFeatures::HasAVX2();
+#endif
+#ifdef PIXEL_KERNEL_AVX512
+	case KERNEL_AVX512:
+		return CPUFeatures::HasAVX512();
+#endif
+	default:
+		return false;
+	}
+}
+
+PixelKernel PixelKernel::Create(Type type) {
+	PixelKernel k;
+	k.type			= KERNEL_SCALAR;
+	k.name			= "scalar";
+	k.blockWidth	= 2;
+	k.lanes			= 4;
+	k.func			= PixelBlockScalar;
+
+	if (!IsSupported(type)) {
+		return k;
+	}
+#ifdef PIXEL_KERNEL_SSE2
+	if (type == KERNEL_SSE2) {
+		k.type	= KERNEL_SSE2;
+		k.name	= "sse2";
+		k.func	= PixelBlockSSE2;
+	}
+#endif
+#ifdef PIXEL_KERNEL_SSE42
+	if (type == KERNEL_SSE42) {
+		k.type	= KERNEL_SSE42;
+		k.name	= "sse4.2";
+		k.func	= PixelBlockSSE42;
+	}
+#endif
+#ifdef PIXEL_KERNEL_AVX2
+	if (type == KERNEL_AVX2) {
+		k.type			= KERNEL_AVX2;
+		k.name			= "avx2";
+		k.blockWidth	= 4;
+		k.lanes			= 8;
+		k.func			= PixelBlockAVX2;
+	}
+#endif
+#ifdef PIXEL_KERNEL_AVX512
+	if (type == KERNEL_AVX512) {
+		k.type			= KERNEL_AVX512;
+		k.name			= "avx512";
+		k.blockWidth	= 8;
+		k.lanes			= 16;
+		k.func			= PixelBlockAVX512;
+	}
+#endif
+	return k;
+}
+
+PixelKernel PixelKernel::CreateBest() {
+	const Type best[] = { KERNEL_AVX512, KERNEL_AVX2, KERNEL_SSE42, KERNEL_SSE2 };
+
+	for (int i = 0; i < 4; ++i) {
+		if (IsSupported(best[i])) {
+			return Create(best[i]);
+		}
+	}
+	return Create(KERNEL_SCALAR);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	SCALAR KERNEL	****************************
+*///////////////////////////////////////////////////////////
+
+void PixelBlockScalar(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out) {
+	int64_t e[4][3];
+	int covered = 0;
+
+	for (int lane = 0; lane < 4; ++lane) {
+		int lx = PixelKernel::LaneX(lane);
+		int ly = PixelKernel::LaneY(lane);
+
+		for (int i = 0; i < 3; ++i) {
+			e[lane][i] = edge[i] + (lx * tri.edgeDx[i]) + (ly * tri.edgeDy[i]);
+		}
+
+		int px = x + lx;
+		int py = y + ly;
+
+		if (px < tri.minX || px > tri.maxX || py < tri.minY || py > tri.maxY) {
+			continue;
+		}
+
+		if ((e[lane][0] + tri.edgeBias[0]) >= 0 && (e[lane][1] + tri.edgeBias[1]) >= 0 && (e[lane][2] + tri.edgeBias[2]) >= 0) {
+			covered |= 1 << lane;
+		}
+	}
+
+	out.mask	= 0;
+	out.covered	= covered;
+
+	if (!covered) {
+		return;
+	}
+
+	for (int lane = 0; lane < 4; ++lane) {
+		//weights are wanted even for uncovered lanes, for derivatives
+		float alpha = e[lane][0] * tri.areaRecip;
+		float beta	= e[lane][1] * tri.areaRecip;
+		float gamma = e[lane][2] * tri.areaRecip;
+
+		out.alpha[lane] = alpha;
+		out.beta[lane]	= beta;
+		out.gamma[lane] = gamma;
+
+		if (!(covered & (1 << lane))) {
+			continue;
+		}
+
+		float zVal = (tri.z[0] * alpha) + (tri.z[1] * beta) + (tri.z[2] * gamma);
+		unsigned int castVal = (unsigned int)max(zVal, 0.0f);
+
+		int px = x + PixelKernel::LaneX(lane);
+		int py = y + PixelKernel::LaneY(lane);
+
+		unsigned short &depth = tri.depthBuffer[(py * tri.depthPitch) + px];
+		if (castVal > depth) {
+			continue;
+		}
+		depth = castVal;
+
+		out.mask |= 1 << lane;
+
+		if (tri.vertexColour) {
+			unsigned int packed = 0;
+			for (int i = 0; i < 4; ++i) {
+				float c = (tri.colour[0][i] * alpha) + (tri.colour[1][i] * beta) + (tri.colour[2][i] * gamma);
+				c = clamp(c, 0.0f, 255.0f);
+				packed |= ((unsigned int)c) << (i * 8);
+			}
+			out.colour[lane] = packed;
+		}
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	SSE2 KERNEL	********************************
+*///////////////////////////////////////////////////////////
+
+#ifdef PIXEL_KERNEL_SSE2
+
+void PixelBlockSSE2(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out) {
+	//one 2x2 quad - lanes are (0,0) (1,0) (0,1) (1,1)
+	const __m128i laneXMask = _mm_setr_epi32(0, -1, 0, -1);
+	const __m128i laneYMask = _mm_setr_epi32(0, 0, -1, -1);
+	const __m128 laneX		= _mm_setr_ps(0.0f, 1.0f, 0.0f, 1.0f);
+	const __m128 laneY		= _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+	const __m128i minusOne	= _mm_set1_epi32(-1);
+
+	__m128i covered = minusOne;
+
+	for (int i = 0; i < 3; ++i) {
+		__m128i e = _mm_set1_epi32(ClampEdgeFunction(edge[i]) + tri.edgeBias[i]);
+		e = _mm_add_epi32(e, _mm_and_si128(laneXMask, _mm_set1_epi32((int)tri.edgeDx[i])));
+		e = _mm_add_epi32(e, _mm_and_si128(laneYMask, _mm_set1_epi32((int)tri.edgeDy[i])));
+		covered = _mm_and_si128(covered, _mm_cmpgt_epi32(e, minusOne));
+	}
+
+	bool inside = x >= tri.minX && (x + 1) <= tri.maxX && y >= tri.minY && (y + 1) <= tri.maxY;
+
+	if (!inside) {
+		__m128i px = _mm_add_epi32(_mm_set1_epi32(x), _mm_and_si128(laneXMask, _mm_set1_epi32(1)));
+		__m128i py = _mm_add_epi32(_mm_set1_epi32(y), _mm_and_si128(laneYMask, _mm_set1_epi32(1)));
+		covered = _mm_and_si128(covered, _mm_cmpgt_epi32(px, _mm_set1_epi32(tri.minX - 1)));
+		covered = _mm_and_si128(covered, _mm_cmplt_epi32(px, _mm_set1_epi32(tri.maxX + 1)));
+		covered = _mm_and_si128(covered, _mm_cmpgt_epi32(py, _mm_set1_epi32(tri.minY - 1)));
+		covered = _mm_and_si128(covered, _mm_cmplt_epi32(py, _mm_set1_epi32(tri.maxY + 1)));
+	}
+
+	int coveredMask = _mm_movemask_ps(_mm_castsi128_ps(covered));
+	out.covered = coveredMask;
+
+	if (coveredMask == 0) {
+		out.mask = 0;
+		return;
+	}
+
+	//weights are wanted even for uncovered lanes, for derivatives
+	__m128 weights[3];
+
+	for (int i = 0; i < 3; ++i) {
+		__m128 w = _mm_set1_ps(edge[i] * tri.areaRecip);
+		w = _mm_add_ps(w, _mm_mul_ps(laneX, _mm_set1_ps(tri.weightDx[i])));
+		w = _mm_add_ps(w, _mm_mul_ps(laneY, _mm_set1_ps(tri.weightDy[i])));
+		weights[i] = w;
+	}
+
+	_mm_storeu_ps(out.alpha, weights[0]);
+	_mm_storeu_ps(out.beta, weights[1]);
+	_mm_storeu_ps(out.gamma, weights[2]);
+
+	__m128 z = _mm_mul_ps(weights[0], _mm_set1_ps(tri.z[0]));
+	z = _mm_add_ps(z, _mm_mul_ps(weights[1], _mm_set1_ps(tri.z[1])));
+	z = _mm_add_ps(z, _mm_mul_ps(weights[2], _mm_set1_ps(tri.z[2])));
+	__m128i zInt = _mm_cvttps_epi32(_mm_max_ps(z, _mm_setzero_ps()));
+
+	unsigned short* row0 = tri.depthBuffer + (y * tri.depthPitch) + x;
+	unsigned short* row1 = row0 + tri.depthPitch;
+
+	int mask;
+
+	if (inside) {
+		int bits0, bits1;
+		memcpy(&bits0, row0, sizeof(int));
+		memcpy(&bits1, row1, sizeof(int));
+
+		__m128i depth = _mm_unpacklo_epi32(_mm_cvtsi32_si128(bits0), _mm_cvtsi32_si128(bits1));
+		depth = _mm_unpacklo_epi16(depth, _mm_setzero_si128());
+
+		__m128i pass = _mm_andnot_si128(_mm_cmpgt_epi32(zInt, depth), covered);
+		mask = _mm_movemask_ps(_mm_castsi128_ps(pass));
+
+		if (mask) {
+			__m128i written = _mm_or_si128(_mm_and_si128(pass, zInt), _mm_andnot_si128(pass, depth));
+			//no unsigned 32 -> 16 bit pack before SSE4.1, so bias into signed range and back
+			written = _mm_sub_epi32(written, _mm_set1_epi32(32768));
+			written = _mm_packs_epi32(written, written);
+			written = _mm_xor_si128(written, _mm_set1_epi16((short)0x8000));
+
+			bits0 = _mm_cvtsi128_si32(written);
+			bits1 = _mm_cvtsi128_si32(_mm_srli_si128(written, 4));
+			memcpy(row0, &bits0, sizeof(int));
+			memcpy(row1, &bits1, sizeof(int));
+		}
+	}
+	else {
+		//on the edge of the box, so only touch the lanes we're allowed to
+		int zLanes[4];
+		_mm_storeu_si128((__m128i*)zLanes, zInt);
+
+		mask = 0;
+		for (int lane = 0; lane < 4; ++lane) {
+			if (!(coveredMask & (1 << lane))) {
+				continue;
+			}
+			unsigned short &depth = (lane & 2 ? row1 : row0)[lane & 1];
+			if ((unsigned int)zLanes[lane] > depth) {
+				continue;
+			}
+			depth = (unsigned short)zLanes[lane];
+			mask |= 1 << lane;
+		}
+	}
+
+	out.mask = mask;
+
+	if (mask && tri.vertexColour) {
+		const __m128 zero	= _mm_setzero_ps();
+		const __m128 full	= _mm_set1_ps(255.0f);
+		__m128i packed		= _mm_setzero_si128();
+
+		for (int i = 0; i < 4; ++i) {
+			__m128 c = _mm_mul_ps(weights[0], _mm_set1_ps(tri.colour[0][i]));
+			c = _mm_add_ps(c, _mm_mul_ps(weights[1], _mm_set1_ps(tri.colour[1][i])));
+			c = _mm_add_ps(c, _mm_mul_ps(weights[2], _mm_set1_ps(tri.colour[2][i])));
+			c = _mm_min_ps(_mm_max_ps(c, zero), full);
+			packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(c), i * 8));
+		}
+		_mm_storeu_si128((__m128i*)out.colour, packed);
+	}
+}
+
+#endif
@@ -0,0 +1,129 @@
+/******************************************************************************
+Class:PixelKernel
+Implements:
+Author:Geoff Whitehead
+Description:The per pixel part of the edge function triangle fill. A kernel
+takes a block of pixels two rows tall - one 2x2 quad for the scalar and SSE
+versions, two quads side by side for AVX2, four for AVX-512 - and works out
+which of them the
+triangle covers, interpolates their depth and runs the depth test, all at
+once. It also hands back the barycentric weights of every pixel in the block
+(covered or not), so the rasteriser can take texture derivatives across each
+quad, and for vertex coloured triangles the interpolated colour.
+
+The best kernel the CPU supports is picked at runtime.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CPUFeatures.h"
+
+#include <cstdint>
+
+#define PIXEL_KERNEL_MAX_LANES 16
+
+//The SIMD kernels do their coverage test in 32 bit lanes, which is exact as
+//long as a single edge function step fits comfortably in 32 bits. Triangles
+//with bigger steps than this go through the scalar kernel instead.
+#define PIXEL_KERNEL_MAX_STEP (1 << 24)
+
+#ifdef SR_X86
+#define PIXEL_KERNEL_SSE2
+//Visual Studio will always emit SSE4.2 and AVX2 intrinsics (and AVX-512 from
+//2017 on), other compilers need each kernel's file building with the right
+//flags, and the matching SR_ENABLE_ define set. CMakeLists.txt does both.
+#if defined(_MSC_VER) || defined(SR_ENABLE_SSE42)
+#define PIXEL_KERNEL_SSE42
+#endif
+#if defined(_MSC_VER) || defined(SR_ENABLE_AVX2)
+#define PIXEL_KERNEL_AVX2
+#endif
+#if (defined(_MSC_VER) && _MSC_VER >= 1911) || defined(SR_ENABLE_AVX512)
+#define PIXEL_KERNEL_AVX512
+#endif
+#endif
+
+//Everything a kernel needs to know about the triangle, set up once by
+//RasteriseTriEdges before it walks the blocks
+struct TriangleSetup {
+	int64_t	edgeDx[3];		//per pixel step of each edge function along x
+	int64_t	edgeDy[3];		//...and along y
+	int		edgeBias[3];	//0 for top-left edges, -1 for the rest
+
+	float	weightDx[3];	//the same steps, as barycentric weights
+	float	weightDy[3];
+	float	areaRecip;		//1 / edge function value at the opposite vertex
+
+	float	z[3];			//viewport depth at each vertex
+
+	bool	vertexColour;	//should the kernel interpolate colours?
+	float	colour[3][4];	//b, g, r, a of each vertex, as floats
+
+	int		minX, minY;		//pixels outside this box are never touched
+	int		maxX, maxY;
+
+	unsigned short* depthBuffer;
+	int		depthPitch;
+};
+
+struct PixelBlock {
+	int				mask;	//bit per lane that is covered and passed the depth test
+	int				covered;	//bit per lane that is covered, before the depth test
+	float			alpha[PIXEL_KERNEL_MAX_LANES];
+	float			beta[PIXEL_KERNEL_MAX_LANES];
+	float			gamma[PIXEL_KERNEL_MAX_LANES];
+	unsigned int	colour[PIXEL_KERNEL_MAX_LANES];
+};
+
+//Edge function values far from zero are clamped before being put in 32 bit
+//lanes. Anything past the clamp is further from the edge than a whole block
+//of steps, so every lane keeps the sign it would have had.
+static inline int ClampEdgeFunction(int64_t e) {
+	const int64_t limit = (int64_t)1 << 30;
+	return (int)(e > limit ? limit : (e < -limit ? -limit : e));
+}
+
+//edge holds the three edge function values at the block's bottom left pixel
+typedef void (*PixelBlockFunc)(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out);
+
+class PixelKernel {
+public:
+	enum Type {
+		KERNEL_SCALAR,
+		KERNEL_SSE2,
+		KERNEL_SSE42,
+		KERNEL_AVX2,
+		KERNEL_AVX512
+	};
+
+	static bool			IsSupported(Type type);
+	static PixelKernel	Create(Type type);
+	static PixelKernel	CreateBest();
+
+	//Lane i of a block lives at quad (i / 4), and within that quad at
+	//x + (i & 1), y + ((i >> 1) & 1), so lanes i + 1 and i + 2 of a quad's
+	//first lane are its right and upper neighbours
+	static inline int	LaneX(int lane) { return ((lane >> 2) << 1) + (lane & 1); }
+	static inline int	LaneY(int lane) { return (lane >> 1) & 1; }
+
+	Type			type;
+	const char*		name;
+	int				blockWidth;	//blocks are always 2 pixels tall
+	int				lanes;
+	PixelBlockFunc	func;
+};
+
+void PixelBlockScalar(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out);
+#ifdef PIXEL_KERNEL_SSE2
+void PixelBlockSSE2(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out);
+#endif
+#ifdef PIXEL_KERNEL_SSE42
+void PixelBlockSSE42(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out);
+#endif
+#ifdef PIXEL_KERNEL_AVX2
+void PixelBlockAVX2(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out);
+#endif
+#ifdef PIXEL_KERNEL_AVX512
+void PixelBlockAVX512(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out);
+#endif
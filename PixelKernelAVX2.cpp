@@ -0,0 +1,138 @@
+#include "PixelKernel.h"
+
+/*
+Kept in a file of its own so that it can be built with AVX2 code generation
+switched on without letting AVX2 instructions leak into code that has to run
+on every machine.
+*/
+
+#ifdef PIXEL_KERNEL_AVX2
+
+#include <immintrin.h>
+#include <cstring>
+
+/*//////////////////////////////////////////////////////////
+//**********	AVX2 KERNEL	********************************
+*///////////////////////////////////////////////////////////
+
+void PixelBlockAVX2(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out) {
+	//two 2x2 quads side by side, see PixelKernel::LaneX / LaneY
+	const __m256i laneXInt	= _mm256_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3);
+	const __m256i laneYInt	= _mm256_setr_epi32(0, 0, 1, 1, 0, 0, 1, 1);
+	const __m256 laneX		= _mm256_cvtepi32_ps(laneXInt);
+	const __m256 laneY		= _mm256_cvtepi32_ps(laneYInt);
+	const __m256i minusOne	= _mm256_set1_epi32(-1);
+
+	__m256i covered = minusOne;
+
+	for (int i = 0; i < 3; ++i) {
+		__m256i e = _mm256_set1_epi32(ClampEdgeFunction(edge[i]) + tri.edgeBias[i]);
+		e = _mm256_add_epi32(e, _mm256_mullo_epi32(laneXInt, _mm256_set1_epi32((int)tri.edgeDx[i])));
+		e = _mm256_add_epi32(e, _mm256_mullo_epi32(laneYInt, _mm256_set1_epi32((int)tri.edgeDy[i])));
+		covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(e, minusOne));
+	}
+
+	bool inside = x >= tri.minX && (x + 3) <= tri.maxX && y >= tri.minY && (y + 1) <= tri.maxY;
+
+	if (!inside) {
+		__m256i px = _mm256_add_epi32(_mm256_set1_epi32(x), laneXInt);
+		__m256i py = _mm256_add_epi32(_mm256_set1_epi32(y), laneYInt);
+		covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(px, _mm256_set1_epi32(tri.minX - 1)));
+		covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(_mm256_set1_epi32(tri.maxX + 1), px));
+		covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(py, _mm256_set1_epi32(tri.minY - 1)));
+		covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(_mm256_set1_epi32(tri.maxY + 1), py));
+	}
+
+	int coveredMask = _mm256_movemask_ps(_mm256_castsi256_ps(covered));
+	out.covered = coveredMask;
+
+	if (coveredMask == 0) {
+		out.mask = 0;
+		return;
+	}
+
+	//weights are wanted even for uncovered lanes, for derivatives
+	__m256 weights[3];
+
+	for (int i = 0; i < 3; ++i) {
+		__m256 w = _mm256_set1_ps(edge[i] * tri.areaRecip);
+		w = _mm256_add_ps(w, _mm256_mul_ps(laneX, _mm256_set1_ps(tri.weightDx[i])));
+		w = _mm256_add_ps(w, _mm256_mul_ps(laneY, _mm256_set1_ps(tri.weightDy[i])));
+		weights[i] = w;
+	}
+
+	_mm256_storeu_ps(out.alpha, weights[0]);
+	_mm256_storeu_ps(out.beta, weights[1]);
+	_mm256_storeu_ps(out.gamma, weights[2]);
+
+	__m256 z = _mm256_mul_ps(weights[0], _mm256_set1_ps(tri.z[0]));
+	z = _mm256_add_ps(z, _mm256_mul_ps(weights[1], _mm256_set1_ps(tri.z[1])));
+	z = _mm256_add_ps(z, _mm256_mul_ps(weights[2], _mm256_set1_ps(tri.z[2])));
+	__m256i zInt = _mm256_cvttps_epi32(_mm256_max_ps(z, _mm256_setzero_ps()));
+
+	unsigned short* row0 = tri.depthBuffer + (y * tri.depthPitch) + x;
+	unsigned short* row1 = row0 + tri.depthPitch;
+
+	int mask;
+
+	if (inside) {
+		long long bits0, bits1;
+		memcpy(&bits0, row0, sizeof(long long));
+		memcpy(&bits1, row1, sizeof(long long));
+
+		//interleave the rows a pair of pixels at a time to get quad lane order
+		__m128i rows = _mm_unpacklo_epi32(_mm_loadl_epi64((const __m128i*)&bits0), _mm_loadl_epi64((const __m128i*)&bits1));
+		__m256i depth = _mm256_cvtepu16_epi32(rows);
+
+		__m256i pass = _mm256_andnot_si256(_mm256_cmpgt_epi32(zInt, depth), covered);
+		mask = _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+
+		if (mask) {
+			__m256i written = _mm256_blendv_epi8(depth, zInt, pass);
+			__m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(written), _mm256_extracti128_si256(written, 1));
+			//back from quad lane order to two rows of four
+			packed = _mm_shuffle_epi32(packed, _MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm_storel_epi64((__m128i*)&bits0, packed);
+			_mm_storel_epi64((__m128i*)&bits1, _mm_unpackhi_epi64(packed, packed));
+			memcpy(row0, &bits0, sizeof(long long));
+			memcpy(row1, &bits1, sizeof(long long));
+		}
+	}
+	else {
+		int zLanes[8];
+		_mm256_storeu_si256((__m256i*)zLanes, zInt);
+
+		mask = 0;
+		for (int lane = 0; lane < 8; ++lane) {
+			if (!(coveredMask & (1 << lane))) {
+				continue;
+			}
+			unsigned short &depth = ((lane & 2) ? row1 : row0)[PixelKernel::LaneX(lane)];
+			if ((unsigned int)zLanes[lane] > depth) {
+				continue;
+			}
+			depth = (unsigned short)zLanes[lane];
+			mask |= 1 << lane;
+		}
+	}
+
+	out.mask = mask;
+
+	if (mask && tri.vertexColour) {
+		const __m256 zero	= _mm256_setzero_ps();
+		const __m256 full	= _mm256_set1_ps(255.0f);
+		__m256i packed		= _mm256_setzero_si256();
+
+		for (int i = 0; i < 4; ++i) {
+			__m256 c = _mm256_mul_ps(weights[0], _mm256_set1_ps(tri.colour[0][i]));
+			c = _mm256_add_ps(c, _mm256_mul_ps(weights[1], _mm256_set1_ps(tri.colour[1][i])));
+			c = _mm256_add_ps(c, _mm256_mul_ps(weights[2], _mm256_set1_ps(tri.colour[2][i])));
+			c = _mm256_min_ps(_mm256_max_ps(c, zero), full);
+			packed = _mm256_or_si256(packed, _mm256_slli_epi32(_mm256_cvttps_epi32(c), i * 8));
+		}
+		_mm256_storeu_si256((__m256i*)out.colour, packed);
+	}
+}
+
+#endif
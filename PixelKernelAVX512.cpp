@@ -0,0 +1,133 @@
+#include "PixelKernel.h"
+
+/*
+Kept in a file of its own for the same reasons as the AVX2 kernel. Only the
+AVX-512 foundation instructions are used, so any AVX-512 CPU can run it.
+*/
+
+#ifdef PIXEL_KERNEL_AVX512
+
+#include <immintrin.h>
+
+/*//////////////////////////////////////////////////////////
+//**********	AVX-512 KERNEL	****************************
+*///////////////////////////////////////////////////////////
+
+void PixelBlockAVX512(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out) {
+	//four 2x2 quads side by side, see PixelKernel::LaneX / LaneY
+	const __m512i laneXInt	= _mm512_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3, 4, 5, 4, 5, 6, 7, 6, 7);
+	const __m512i laneYInt	= _mm512_setr_epi32(0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1);
+	const __m512 laneX		= _mm512_cvtepi32_ps(laneXInt);
+	const __m512 laneY		= _mm512_cvtepi32_ps(laneYInt);
+	const __m512i minusOne	= _mm512_set1_epi32(-1);
+
+	__mmask16 covered = 0xFFFF;
+
+	for (int i = 0; i < 3; ++i) {
+		__m512i e = _mm512_set1_epi32(ClampEdgeFunction(edge[i]) + tri.edgeBias[i]);
+		e = _mm512_add_epi32(e, _mm512_mullo_epi32(laneXInt, _mm512_set1_epi32((int)tri.edgeDx[i])));
+		e = _mm512_add_epi32(e, _mm512_mullo_epi32(laneYInt, _mm512_set1_epi32((int)tri.edgeDy[i])));
+		covered = _mm512_mask_cmpgt_epi32_mask(covered, e, minusOne);
+	}
+
+	bool inside = x >= tri.minX && (x + 7) <= tri.maxX && y >= tri.minY && (y + 1) <= tri.maxY;
+
+	if (!inside) {
+		__m512i px = _mm512_add_epi32(_mm512_set1_epi32(x), laneXInt);
+		__m512i py = _mm512_add_epi32(_mm512_set1_epi32(y), laneYInt);
+		covered = _mm512_mask_cmpge_epi32_mask(covered, px, _mm512_set1_epi32(tri.minX));
+		covered = _mm512_mask_cmple_epi32_mask(covered, px, _mm512_set1_epi32(tri.maxX));
+		covered = _mm512_mask_cmpge_epi32_mask(covered, py, _mm512_set1_epi32(tri.minY));
+		covered = _mm512_mask_cmple_epi32_mask(covered, py, _mm512_set1_epi32(tri.maxY));
+	}
+
+	out.covered = covered;
+
+	if (covered == 0) {
+		out.mask = 0;
+		return;
+	}
+
+	//weights are wanted even for uncovered lanes, for derivatives
+	__m512 weights[3];
+
+	for (int i = 0; i < 3; ++i) {
+		__m512 w = _mm512_set1_ps(edge[i] * tri.areaRecip);
+		w = _mm512_add_ps(w, _mm512_mul_ps(laneX, _mm512_set1_ps(tri.weightDx[i])));
+		w = _mm512_add_ps(w, _mm512_mul_ps(laneY, _mm512_set1_ps(tri.weightDy[i])));
+		weights[i] = w;
+	}
+
+	_mm512_storeu_ps(out.alpha, weights[0]);
+	_mm512_storeu_ps(out.beta, weights[1]);
+	_mm512_storeu_ps(out.gamma, weights[2]);
+
+	__m512 z = _mm512_mul_ps(weights[0], _mm512_set1_ps(tri.z[0]));
+	z = _mm512_add_ps(z, _mm512_mul_ps(weights[1], _mm512_set1_ps(tri.z[1])));
+	z = _mm512_add_ps(z, _mm512_mul_ps(weights[2], _mm512_set1_ps(tri.z[2])));
+	__m512i zInt = _mm512_cvttps_epi32(_mm512_max_ps(z, _mm512_setzero_ps()));
+
+	unsigned short* row0 = tri.depthBuffer + (y * tri.depthPitch) + x;
+	unsigned short* row1 = row0 + tri.depthPitch;
+
+	int mask;
+
+	if (inside) {
+		__m128i bits0 = _mm_loadu_si128((const __m128i*)row0);
+		__m128i bits1 = _mm_loadu_si128((const __m128i*)row1);
+
+		//interleave the rows a pair of pixels at a time to get quad lane order
+		__m256i rows = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi32(bits0, bits1)),
+			_mm_unpackhi_epi32(bits0, bits1), 1);
+		__m512i depth = _mm512_cvtepu16_epi32(rows);
+
+		__mmask16 pass = _mm512_mask_cmple_epi32_mask(covered, zInt, depth);
+		mask = pass;
+
+		if (mask) {
+			__m256i packed = _mm512_cvtepi32_epi16(_mm512_mask_blend_epi32(pass, depth, zInt));
+			//back from quad lane order to two rows of eight
+			__m128i lo = _mm_shuffle_epi32(_mm256_castsi256_si128(packed), _MM_SHUFFLE(3, 1, 2, 0));
+			__m128i hi = _mm_shuffle_epi32(_mm256_extracti128_si256(packed, 1), _MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm_storeu_si128((__m128i*)row0, _mm_unpacklo_epi64(lo, hi));
+			_mm_storeu_si128((__m128i*)row1, _mm_unpackhi_epi64(lo, hi));
+		}
+	}
+	else {
+		int zLanes[16];
+		_mm512_storeu_si512(zLanes, zInt);
+
+		mask = 0;
+		for (int lane = 0; lane < 16; ++lane) {
+			if (!(covered & (1 << lane))) {
+				continue;
+			}
+			unsigned short &depth = ((lane & 2) ? row1 : row0)[PixelKernel::LaneX(lane)];
+			if ((unsigned int)zLanes[lane] > depth) {
+				continue;
+			}
+			depth = (unsigned short)zLanes[lane];
+			mask |= 1 << lane;
+		}
+	}
+
+	out.mask = mask;
+
+	if (mask && tri.vertexColour) {
+		const __m512 zero	= _mm512_setzero_ps();
+		const __m512 full	= _mm512_set1_ps(255.0f);
+		__m512i packed		= _mm512_setzero_si512();
+
+		for (int i = 0; i < 4; ++i) {
+			__m512 c = _mm512_mul_ps(weights[0], _mm512_set1_ps(tri.colour[0][i]));
+			c = _mm512_add_ps(c, _mm512_mul_ps(weights[1], _mm512_set1_ps(tri.colour[1][i])));
+			c = _mm512_add_ps(c, _mm512_mul_ps(weights[2], _mm512_set1_ps(tri.colour[2][i])));
+			c = _mm512_min_ps(_mm512_max_ps(c, zero), full);
+			packed = _mm512_or_si512(packed, _mm512_slli_epi32(_mm512_cvttps_epi32(c), i * 8));
+		}
+		_mm512_storeu_si512(out.colour, packed);
+	}
+}
+
+#endif
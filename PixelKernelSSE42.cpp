@@ -0,0 +1,135 @@
+#include "PixelKernel.h"
+
+/*
+The SSE2 kernel again, using the SSE4.1 instructions it has to work around:
+an unsigned 32 -> 16 bit pack, widening loads and byte blends. Kept in a file
+of its own for the same reasons as the AVX2 kernel.
+*/
+
+#ifdef PIXEL_KERNEL_SSE42
+
+#include <smmintrin.h>
+#include <cstring>
+
+/*//////////////////////////////////////////////////////////
+//**********	SSE4.2 KERNEL	****************************
+*///////////////////////////////////////////////////////////
+
+void PixelBlockSSE42(const TriangleSetup &tri, int x, int y, const int64_t edge[3], PixelBlock &out) {
+	//one 2x2 quad - lanes are (0,0) (1,0) (0,1) (1,1)
+	const __m128i laneXInt	= _mm_setr_epi32(0, 1, 0, 1);
+	const __m128i laneYInt	= _mm_setr_epi32(0, 0, 1, 1);
+	const __m128 laneX		= _mm_cvtepi32_ps(laneXInt);
+	const __m128 laneY		= _mm_cvtepi32_ps(laneYInt);
+	const __m128i minusOne	= _mm_set1_epi32(-1);
+
+	__m128i covered = minusOne;
+
+	for (int i = 0; i < 3; ++i) {
+		__m128i e = _mm_set1_epi32(ClampEdgeFunction(edge[i]) + tri.edgeBias[i]);
+		e = _mm_add_epi32(e, _mm_mullo_epi32(laneXInt, _mm_set1_epi32((int)tri.edgeDx[i])));
+		e = _mm_add_epi32(e, _mm_mullo_epi32(laneYInt, _mm_set1_epi32((int)tri.edgeDy[i])));
+		covered = _mm_and_si128(covered, _mm_cmpgt_epi32(e, minusOne));
+	}
+
+	bool inside = x >= tri.minX && (x + 1) <= tri.maxX && y >= tri.minY && (y + 1) <= tri.maxY;
+
+	if (!inside) {
+		__m128i px = _mm_add_epi32(_mm_set1_epi32(x), laneXInt);
+		__m128i py = _mm_add_epi32(_mm_set1_epi32(y), laneYInt);
+		covered = _mm_and_si128(covered, _mm_cmpgt_epi32(px, _mm_set1_epi32(tri.minX - 1)));
+		covered = _mm_and_si128(covered, _mm_cmplt_epi32(px, _mm_set1_epi32(tri.maxX + 1)));
+		covered = _mm_and_si128(covered, _mm_cmpgt_epi32(py, _mm_set1_epi32(tri.minY - 1)));
+		covered = _mm_and_si128(covered, _mm_cmplt_epi32(py, _mm_set1_epi32(tri.maxY + 1)));
+	}
+
+	int coveredMask = _mm_movemask_ps(_mm_castsi128_ps(covered));
+	out.covered = coveredMask;
+
+	if (coveredMask == 0) {
+		out.mask = 0;
+		return;
+	}
+
+	//weights are wanted even for uncovered lanes, for derivatives
+	__m128 weights[3];
+
+	for (int i = 0; i < 3; ++i) {
+		__m128 w = _mm_set1_ps(edge[i] * tri.areaRecip);
+		w = _mm_add_ps(w, _mm_mul_ps(laneX, _mm_set1_ps(tri.weightDx[i])));
+		w = _mm_add_ps(w, _mm_mul_ps(laneY, _mm_set1_ps(tri.weightDy[i])));
+		weights[i] = w;
+	}
+
+	_mm_storeu_ps(out.alpha, weights[0]);
+	_mm_storeu_ps(out.beta, weights[1]);
+	_mm_storeu_ps(out.gamma, weights[2]);
+
+	__m128 z = _mm_mul_ps(weights[0], _mm_set1_ps(tri.z[0]));
+	z = _mm_add_ps(z, _mm_mul_ps(weights[1], _mm_set1_ps(tri.z[1])));
+	z = _mm_add_ps(z, _mm_mul_ps(weights[2], _mm_set1_ps(tri.z[2])));
+	__m128i zInt = _mm_cvttps_epi32(_mm_max_ps(z, _mm_setzero_ps()));
+
+	unsigned short* row0 = tri.depthBuffer + (y * tri.depthPitch) + x;
+	unsigned short* row1 = row0 + tri.depthPitch;
+
+	int mask;
+
+	if (inside) {
+		int bits0, bits1;
+		memcpy(&bits0, row0, sizeof(int));
+		memcpy(&bits1, row1, sizeof(int));
+
+		__m128i depth = _mm_cvtepu16_epi32(_mm_insert_epi32(_mm_cvtsi32_si128(bits0), bits1, 1));
+
+		__m128i pass = _mm_andnot_si128(_mm_cmpgt_epi32(zInt, depth), covered);
+		mask = _mm_movemask_ps(_mm_castsi128_ps(pass));
+
+		if (mask) {
+			__m128i written = _mm_blendv_epi8(depth, zInt, pass);
+			written = _mm_packus_epi32(written, written);
+
+			bits0 = _mm_cvtsi128_si32(written);
+			bits1 = _mm_extract_epi32(written, 1);
+			memcpy(row0, &bits0, sizeof(int));
+			memcpy(row1, &bits1, sizeof(int));
+		}
+	}
+	else {
+		//on the edge of the box, so only touch the lanes we're allowed to
+		int zLanes[4];
+		_mm_storeu_si128((__m128i*)zLanes, zInt);
+
+		mask = 0;
+		for (int lane = 0; lane < 4; ++lane) {
+			if (!(coveredMask & (1 << lane))) {
+				continue;
+			}
+			unsigned short &depth = (lane & 2 ? row1 : row0)[lane & 1];
+			if ((unsigned int)zLanes[lane] > depth) {
+				continue;
+			}
+			depth = (unsigned short)zLanes[lane];
+			mask |= 1 << lane;
+		}
+	}
+
+	out.mask = mask;
+
+	if (mask && tri.vertexColour) {
+		const __m128 zero	= _mm_setzero_ps();
+		const __m128 full	= _mm_set1_ps(255.0f);
+		__m128i packed		= _mm_setzero_si128();
+
+		for (int i = 0; i < 4; ++i) {
+			__m128 c = _mm_mul_ps(weights[0], _mm_set1_ps(tri.colour[0][i]));
+			c = _mm_add_ps(c, _mm_mul_ps(weights[1], _mm_set1_ps(tri.colour[1][i])));
+			c = _mm_add_ps(c, _mm_mul_ps(weights[2], _mm_set1_ps(tri.colour[2][i])));
+			c = _mm_min_ps(_mm_max_ps(c, zero), full);
+			packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(c), i * 8));
+		}
+		_mm_storeu_si128((__m128i*)out.colour, packed);
+	}
+}
+
+#endif
@@ -4,6 +4,7 @@
 RenderObject::RenderObject(void)	{
 	texture = NULL;
 	mesh	= NULL;
+	streamingMesh = NULL;
 }
 
 
@@ -18,6 +18,7 @@ _-_-_-_-_-_-_-""  ""
 #include "Matrix4.h"
 
 class Texture;
+class StreamingMesh;
 
 class RenderObject	{
 public:
@@ -36,5 +37,8 @@ public:
 
 	Texture*	texture;
 	Mesh*		mesh;
+
+	//drawn instead of mesh if it's set, a chunk at a time - see StreamingMesh
+	StreamingMesh*	streamingMesh;
 };
 
@@ -1,6 +1,9 @@
 #include "SoftwareRasteriser.h"
+#include "StreamingMesh.h"
 #include <cmath>
 #include <math.h>
+#include <cstdint>
+#include <sstream>
 /*
 While less 'neat' than just doing a 'new', like in the tutorials, it's usually
 possible to render a bit quicker to use direct pointers to the drawing area
@@ -36,6 +39,24 @@ get exceptions if you resized to a bigger screen area. Sorry about that.
 SoftwareRasteriser::SoftwareRasteriser(uint width, uint height)	: Window(width, height){
 	currentDrawBuffer	= 0;
 	currentTexture = NULL; //TODO check this is correct!!
+	cullMeshlets = false;
+
+	pixelKernel			= PixelKernel::CreateBest();
+	scalarPixelKernel	= PixelKernel::Create(PixelKernel::KERNEL_SCALAR);
+
+	binning		= false;
+	threadCount = WorkerPool::DefaultThreadCount();
+	workers		= NULL;
+
+	hiZEnabled	= true;
+	guardBandEnabled = true;
+
+	traceFrame	= 0;
+	traceDraw	= 0;
+
+	SelectShadeBlock(false);
+
+	vertexTransform = VertexTransform::CreateBest();
 
 #ifndef USE_OS_BUFFERS
 	//Hi! In the tutorials, it's mentioned that we need to form our front + back buffer like so:
@@ -51,12 +72,16 @@ SoftwareRasteriser::SoftwareRasteriser(uint width, uint height)	: Window(width,
 #endif
 
 	depthBuffer		=	new unsigned short[screenWidth * screenHeight];
+	hiZ.Resize(screenWidth, screenHeight, depthBuffer);
 
 	float zScale	= (pow(2.0f,16) - 1) * 0.5f;
 
 	Vector3 halfScreen = Vector3((screenWidth - 1) * 0.5f, (screenHeight - 1) * 0.5f, zScale);
 
 	portMatrix = Matrix4::Translation(halfScreen) * Matrix4::Scale(halfScreen);
+	ResizeGuardBand(halfScreen);
+
+	ResizeBins();
 }
 
 SoftwareRasteriser::~SoftwareRasteriser(void)	{
@@ -66,6 +91,7 @@ SoftwareRasteriser::~SoftwareRasteriser(void)	{
 	}
 #endif
 	delete[] depthBuffer;
+	delete workers;
 }
 
 void SoftwareRasteriser::Resize() {
@@ -84,12 +110,16 @@ void SoftwareRasteriser::Resize() {
 
 	delete[] depthBuffer;
 	depthBuffer = new unsigned short[screenWidth * screenHeight];
+	hiZ.Resize(screenWidth, screenHeight, depthBuffer);
 
 	float zScale = (pow(2.0f, 16) - 1) * 0.5f;
 
 	Vector3 halfScreen = Vector3((screenWidth - 1) * 0.5f, (screenHeight - 1) * 0.5f, zScale);
 
 	portMatrix = Matrix4::Translation(halfScreen) * Matrix4::Scale(halfScreen);
+	ResizeGuardBand(halfScreen);
+
+	ResizeBins(); //anything already binned was for the old screen size
 }
 
 Colour*	SoftwareRasteriser::GetCurrentBuffer() {
@@ -100,6 +130,20 @@ void	SoftwareRasteriser::ClearBuffers() {
 	
 	//NOTE: This was slightly different to his tutorial code, may cause errors???
 
+	TraceScope scope(trace, "ClearBuffers", "frame");
+	if (scope.IsRecording()) {
+		std::ostringstream args;
+		args << "\"frame\":" << traceFrame++;
+		scope.SetArgs(args.str());
+	}
+	traceDraw = 0;
+
+	//anything binned since the last swap would be cleared away anyway
+	binnedPrims.clear();
+	for (uint i = 0; i < tileBins.size(); ++i) {
+		tileBins[i].clear();
+	}
+
 	Colour* buffer = GetCurrentBuffer();
 
 	unsigned int clearVal = 0xFF000000;
@@ -111,9 +155,17 @@ void	SoftwareRasteriser::ClearBuffers() {
 			depthBuffer[(y * screenWidth) + x] = depthVal;
 		}
 	}
+	hiZ.Clear((unsigned short)depthVal);
+	hiZStats.Reset();
+	pipelineStats.Reset();
 }
 
 void	SoftwareRasteriser::SwapBuffers() {
+	TraceScope scope(trace, "SwapBuffers", "frame");
+
+	if (binning) {
+		RasteriseBins();
+	}
 	PresentBuffer(buffers[currentDrawBuffer]);
 	currentDrawBuffer = !currentDrawBuffer;
 }
@@ -122,8 +174,53 @@ void	SoftwareRasteriser::SwapBuffers() {
 //**********	DRAW OBJECT		****************************
 *///////////////////////////////////////////////////////////
 
+//for the trace
+static const char* PrimitiveTypeName(PrimitiveType type) {
+	switch (type) {
+	case PRIMITIVE_POINTS:		return "points";
+	case PRIMITIVE_LINES:		return "lines";
+	case PRIMITIVE_TRIANGLES:	return "triangles";
+	case PRIMITIVE_TRIFAN:		return "triangle fan";
+	case PRIMITIVE_LINE_STRIPS: return "line strip";
+	case PRIMITIVE_LINE_LOOPS:	return "line loop";
+	case PRIMITIVE_TRISTRIP:	return "triangle strip";
+	}
+	return "unknown";
+}
+
+//does everything o draws have an alpha of 255, so need no blending?
+static bool IsOpaque(RenderObject* o) {
+	if (o->texture) {
+		return o->texture->IsOpaque();
+	}
+	return o->GetMesh()->IsOpaque();
+}
+
 void	SoftwareRasteriser::DrawObject(RenderObject*o) {
+	if (o->streamingMesh) {
+		DrawStreamingObject(o);
+		return;
+	}
+
+	TraceScope scope(trace, "DrawObject", "draw");
+	if (scope.IsRecording()) {
+		std::ostringstream args;
+		args << "\"draw\":" << traceDraw << ",\"type\":\"" << PrimitiveTypeName(o->GetMesh()->GetType())
+			<< "\",\"vertices\":" << o->GetMesh()->numVertices
+			<< ",\"textured\":" << (o->texture ? "true" : "false");
+		scope.SetArgs(args.str());
+	}
+	traceDraw++;
+
+	//meshlets are transformed one at a time, and only if they might be seen
+	cullMeshlets = CanCullMeshlets(o);
+	if (!cullMeshlets) {
+		TransformMesh(o);
+	}
+
 	currentTexture = o->texture;
+	SelectShadeBlock(IsOpaque(o));
+
 	switch (o->GetMesh()->GetType())
 	{
 	case PRIMITIVE_POINTS: {
@@ -150,15 +247,43 @@ void	SoftwareRasteriser::DrawObject(RenderObject*o) {
 	}
 }
 
+//Each chunk is drawn as an object of its own, while the next one is read in.
+//The pipeline copies everything it keeps of a primitive - binned ones too -
+//so nothing still points into a chunk once it's been handed back.
+void	SoftwareRasteriser::DrawStreamingObject(RenderObject* o) {
+	StreamingMesh* s = o->streamingMesh;
+
+	RenderObject chunk	= *o;
+	chunk.streamingMesh	= NULL;
+
+	for (uint i = 0; i < s->GetChunkCount(); ++i) {
+		{
+			TraceScope scope(trace, "WaitForChunk", "stream");
+			chunk.mesh = s->NextChunk();
+		}
+		DrawObject(&chunk);
+	}
+}
+
+//Every vertex of the mesh into clip space, with its outcode, ready for the
+//primitive assembly below to read back out of clipSpace
+void	SoftwareRasteriser::TransformMesh(RenderObject*o) {
+	TraceScope scope(trace, "TransformVertices", "vertex");
+
+	Mesh* m = o->GetMesh();
+	vertexTransform.Transform(viewProjMatrix * o->GetModelMatrix(), m->vertices, m->numVertices, clipSpace);
+
+	PIPELINE_STAT(pipelineStats.verticesTransformed += m->numVertices);
+}
+
 void	SoftwareRasteriser::RasterisePointsMesh(RenderObject*o) {
-	Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
+	PIPELINE_STAT(pipelineStats.pointsSubmitted += o->GetMesh()->numVertices);
 
 	for (uint i = 0; i < o->GetMesh()->numVertices; i++){
-		Vector4 vertexPos = mvp * o->GetMesh()->vertices[i];
+		Vector4 vertexPos = clipSpace.Position(i);
 		vertexPos.SelfDivisionByW();
 
-		Vector4 screenPos = portMatrix * vertexPos;
-		BlendPixel((uint)screenPos.x, (uint)screenPos.y, Colour::White);
+		RasterisePoint(vertexPos, Colour::White);
 	}
 }
 
@@ -169,12 +294,13 @@ void	SoftwareRasteriser::RasterisePointsMesh(RenderObject*o) {
 *///////////////////////////////////////////////////////////
 
 void	SoftwareRasteriser::RasteriseLinesMesh(RenderObject*o) {
-	Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
 	Mesh*m = o->GetMesh();
 
+	PIPELINE_STAT(pipelineStats.linesSubmitted += m->numVertices / 2);
+
 	for (uint i = 0; i < m->numVertices; i += 2){
-		Vector4 v0 = mvp * m->vertices[i];
-		Vector4 v1 = mvp * m->vertices[i+1];
+		Vector4 v0 = clipSpace.Position(i);
+		Vector4 v1 = clipSpace.Position(i+1);
 		
 		Colour c0 = m->colours[i];
 		Colour c1 = m->colours[i+1];
@@ -187,7 +313,8 @@ void	SoftwareRasteriser::RasteriseLinesMesh(RenderObject*o) {
 			m->textureCoords[i+1].x,
 			m->textureCoords[i+1].y, 1.0f);
 
-		if (!CohenSutherlandLine(v0, v1, c0, c1, t0, t1)) {
+		if ((clipSpace.outcodes[i] & clipSpace.outcodes[i+1]) || !CohenSutherlandLine(v0, v1, c0, c1, t0, t1)) {
+			PIPELINE_STAT(pipelineStats.linesClipCulled++);
 			continue;
 		}
 
@@ -209,104 +336,176 @@ void	SoftwareRasteriser::RasteriseLinesMesh(RenderObject*o) {
 *///////////////////////////////////////////////////////////
 
 void SoftwareRasteriser::RasteriseTriMesh(RenderObject *o) {
-	Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
+	if (cullMeshlets) {
+		RasteriseMeshlets(o);
+		return;
+	}
+	if (o->GetMesh()->IsIndexed()) {
+		RasteriseIndexedTriMesh(o);
+		return;
+	}
 
 	Mesh*m = o->GetMesh();
 	
-	for (uint i = 0; i < m->numVertices; i += 3) { // loop through the render object in groups of 3 vertices
-		Vector4 v0 = mvp * m->vertices[i]; // add the 3 vertices of the triangle
-		Vector4 v1 = mvp * m->vertices[i + 1];
-		Vector4 v2 = mvp * m->vertices[i + 2];
+	for (uint i = 0; i + 2 < m->numVertices; i += 3) { // loop through the render object in groups of 3 vertices
+		ClipTriangle(m, i, i + 1, i + 2);
+	}
+}
 
-		//added on tut 10
-		Vector3 t0 = Vector3(
-			m->textureCoords[i].x,
-			m->textureCoords[i].y, 1.0f);// / v0.w;
-		Vector3 t1 = Vector3(
-			m->textureCoords[i + 1].x,
-			m->textureCoords[i + 1].y, 1.0f);// / v1.w;
-		Vector3 t2 = Vector3(
-			m->textureCoords[i + 2].x,
-			m->textureCoords[i + 2].y, 1.0f);// / v2.w;
 
-		SutherlandHodgmanTri(v0, v1, v2,
-			m->colours[i], m->colours[i + 1], m->colours[i + 2], t0, t1, t2);
-		}
+/*//////////////////////////////////////////////////////////
+//**********	RASTERISE INDEXED TRI MESH	****************
+*///////////////////////////////////////////////////////////
+
+//The vertex stage has already transformed and outcoded every vertex, so
+//however many triangles share one, it's only done once
+void SoftwareRasteriser::RasteriseIndexedTriMesh(RenderObject *o) {
+	Mesh* m = o->GetMesh();
+
+	if (m->indices16) {
+		RasteriseIndexedTris(o, m->indices16);
+	}
+	else {
+		RasteriseIndexedTris(o, m->indices32);
+	}
+}
+
+template <typename Index>
+void SoftwareRasteriser::RasteriseIndexedTris(RenderObject *o, const Index* indices) {
+	Mesh* m = o->GetMesh();
+
+	for (uint i = 0; i + 2 < m->numIndices; i += 3) {
+		ClipTriangle(m, indices[i], indices[i + 1], indices[i + 2]);
+	}
 }
 
 /*//////////////////////////////////////////////////////////
-//**********	RASTERISE TRI FANMESH	********************
+//**********	RASTERISE MESHLETS	************************
 *///////////////////////////////////////////////////////////
 
-void SoftwareRasteriser::RasteriseTriFanMesh(RenderObject *o) {
+//The planes and the eye are taken into model space, so the meshlets' bounds
+//can be used as they are. That only holds for the cones if the model view
+//matrix turns, moves and scales evenly - it mustn't stretch, shear or mirror,
+//or normals stop pointing the way their triangles face - and if there's an
+//eye for them to face, so the projection has to be a perspective one.
+//Anything else is drawn the ordinary way, as an indexed mesh.
+bool SoftwareRasteriser::CanCullMeshlets(RenderObject *o) const {
+	if (!o->GetMesh()->HasMeshlets()) {
+		return false;
+	}
+
+	const float* p = projectionMatrix.values;
+	if (p[3] != 0.0f || p[7] != 0.0f || p[11] >= 0.0f || p[15] != 0.0f) {
+		return false;
+	}
 
-		Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
+	Matrix4 modelView = viewMatrix * o->GetModelMatrix();
+	const float* m = modelView.values;
+	Vector3 x(m[0], m[1], m[2]);
+	Vector3 y(m[4], m[5], m[6]);
+	Vector3 z(m[8], m[9], m[10]);
+
+	float scale		= x.Length();
+	float tolerance = scale * 1e-3f;
+	return fabs(y.Length() - scale) <= tolerance && fabs(z.Length() - scale) <= tolerance &&
+		fabs(Vector3::Dot(x, y)) <= tolerance * scale && fabs(Vector3::Dot(y, z)) <= tolerance * scale &&
+		fabs(Vector3::Dot(x, z)) <= tolerance * scale && Vector3::Dot(Vector3::Cross(x, y), z) > 0.0f;
+}
 
-		Mesh*m = o->GetMesh();
+//Meshlets wholly outside a plane of the clip volume, or facing away from
+//the eye, are skipped before any of their vertices are transformed.
+void SoftwareRasteriser::RasteriseMeshlets(RenderObject *o) {
+	Mesh* m = o->GetMesh();
 
-	if (m->numVertices > 2) { // need atleast 3 vert to make a triangle
+	Matrix4 model			= o->GetModelMatrix();
+	Matrix4 modelViewProj	= viewProjMatrix * model;
+	Matrix4 modelView		= viewMatrix * model;
+	Vector3 eye				= modelView.Inverse().GetPositionVector();
+
+	//-w <= x <= w and so on, so each plane is the bottom row of the matrix
+	//plus or minus one of the others
+	float planes[6][4];
+	for (int axis = 0; axis < 3; ++axis) {
+		for (int i = 0; i < 4; ++i) {
+			float w		= modelViewProj.values[3 + i * 4];
+			float row	= modelViewProj.values[axis + i * 4];
+			planes[axis * 2][i]		= w + row;
+			planes[axis * 2 + 1][i] = w - row;
+		}
+	}
+	for (int p = 0; p < 6; ++p) {
+		float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		for (int i = 0; i < 4; ++i) {
+			planes[p][i] /= (length > 0.0f) ? length : 1.0f;
+		}
+	}
 
-		Vector4 v0 = mvp * m->vertices[0];
-		Vector4 v1, v2;
-		Vector3 t0 = Vector3(m->textureCoords[0].x,
-			m->textureCoords[0].y, 1.0f);
-		Vector3 t1, t2;
+	for (size_t i = 0; i < m->meshlets.size(); ++i) {
+		const Meshlet &meshlet = m->meshlets[i];
 
-		for (uint i = 1; i < m->numVertices - 1; i++) {
+		PIPELINE_STAT(pipelineStats.meshletsSubmitted++);
 
-			v1 = mvp * m->vertices[i];
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p) {
+			outside = planes[p][0] * meshlet.centre.x + planes[p][1] * meshlet.centre.y +
+				planes[p][2] * meshlet.centre.z + planes[p][3] < -meshlet.radius;
+		}
+		if (outside) {
+			PIPELINE_STAT(pipelineStats.meshletsFrustumCulled++);
+			continue;
+		}
 
-			t1 = Vector3(m->textureCoords[i].x,
-				m->textureCoords[i].y, 1.0f);
+		Vector3 toApex = meshlet.coneApex - eye;
+		if (meshlet.coneCutoff < 1.0f && Vector3::Dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * toApex.Length()) {
+			PIPELINE_STAT(pipelineStats.meshletsBackFacing++);
+			continue;
+		}
 
-			v2 = mvp * m->vertices[i + 1];
+		vertexTransform.Transform(modelViewProj, m->vertices + meshlet.firstVertex, meshlet.vertexCount, clipSpace);
+		PIPELINE_STAT(pipelineStats.verticesTransformed += meshlet.vertexCount);
 
-			t2 = Vector3(m->textureCoords[i + 1].x,
-				m->textureCoords[i + 1].y, 1.0f);
+		const unsigned char* triangles	= &m->meshletTriangles[meshlet.firstTriangle * 3];
+		const Colour* colours			= m->colours + meshlet.firstVertex;
+		const Vector2* textureCoords	= m->textureCoords + meshlet.firstVertex;
 
-			SutherlandHodgmanTri(v0, v1, v2,
-				m->colours[0], m->colours[i], m->colours[i + 1], t0, t1, t2);
+		for (uint t = 0; t < meshlet.triangleCount; ++t) {
+			ClipTriangle(colours, textureCoords, triangles[t * 3], triangles[t * 3 + 1], triangles[t * 3 + 2]);
 		}
 	}
 }
 
 /*//////////////////////////////////////////////////////////
-//**********	RASTERISE TRI STRIP MESH	****************
+//**********	RASTERISE TRI FANMESH	********************
 *///////////////////////////////////////////////////////////
 
-void SoftwareRasteriser::RasteriseTriStripMesh(RenderObject *o) {
-
-	Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
+void SoftwareRasteriser::RasteriseTriFanMesh(RenderObject *o) {
 
-	Mesh*m = o->GetMesh();
+		Mesh*m = o->GetMesh();
 
 	if (m->numVertices > 2) { // need atleast 3 vert to make a triangle
 
-		Vector4 v0, v1, v2;
-		Vector3 t0, t1, t2;
+		for (uint i = 1; i < m->numVertices - 1; i++) {
+			ClipTriangle(m, 0, i, i + 1);
+		}
+	}
+}
 
-		for (uint i = 0; i < m->numVertices - 2; i++) {
+/*//////////////////////////////////////////////////////////
+//**********	RASTERISE TRI STRIP MESH	****************
+*///////////////////////////////////////////////////////////
 
-			v0 = mvp * m->vertices[i];
-			t0 = Vector3(m->textureCoords[i].x,
-				m->textureCoords[i].y, 1.0f);
+void SoftwareRasteriser::RasteriseTriStripMesh(RenderObject *o) {
 
-			v1 = mvp * m->vertices[i+1];
-			t1 = Vector3(m->textureCoords[i+1].x,
-				m->textureCoords[i+1].y, 1.0f);
+	Mesh*m = o->GetMesh();
 
-			v2 = mvp * m->vertices[i + 2];
-			t2 = Vector3(m->textureCoords[i + 2].x,
-				m->textureCoords[i + 2].y, 1.0f);
+	if (m->numVertices > 2) { // need atleast 3 vert to make a triangle
 
+		for (uint i = 0; i < m->numVertices - 2; i++) {
 			if (i % 2 == 0) {
-				SutherlandHodgmanTri(v0, v1, v2,
-					m->colours[i], m->colours[i+1], m->colours[i + 2], t0, t1, t2);
+				ClipTriangle(m, i, i + 1, i + 2);
 			}
-			else {
-				SutherlandHodgmanTri(v2, v1, v0,
-					m->colours[i+2], m->colours[i+1], m->colours[i], t2, t1, t0);
-
+			else { // every other triangle of a strip winds the other way
+				ClipTriangle(m, i + 2, i + 1, i);
 			}
 		}
 	}
@@ -321,14 +520,15 @@ void SoftwareRasteriser::RasteriseLineStripMesh(RenderObject*o){
 	Mesh* m = o->GetMesh();
 
 	if (m->numVertices > 2){
-		Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
 		Vector4 v0, v1;
 		Colour c0, c1;
 		Vector3 t0, t1;
 
+		PIPELINE_STAT(pipelineStats.linesSubmitted += m->numVertices - 1);
+
 		for (uint i = 0; i < m->numVertices - 1; ++i){
-			v0 = mvp * m->vertices[i];
-			v1 = mvp * m->vertices[i + 1];
+			v0 = clipSpace.Position(i);
+			v1 = clipSpace.Position(i + 1);
 
 			c0 = m->colours[i];
 			c1 = m->colours[i + 1];
@@ -341,7 +541,8 @@ void SoftwareRasteriser::RasteriseLineStripMesh(RenderObject*o){
 				m->textureCoords[i + 1].x,
 				m->textureCoords[i + 1].y, 1.0f);
 
-			if (!CohenSutherlandLine(v0, v1, c0, c1, t0, t1)) {
+			if ((clipSpace.outcodes[i] & clipSpace.outcodes[i + 1]) || !CohenSutherlandLine(v0, v1, c0, c1, t0, t1)) {
+				PIPELINE_STAT(pipelineStats.linesClipCulled++);
 				continue;
 			}
 
@@ -369,14 +570,15 @@ void SoftwareRasteriser::RasteriseLineLoopMesh(RenderObject*o){
 	Mesh* m = o->GetMesh();
 
 	if (m->numVertices > 2){
-	Matrix4 mvp = viewProjMatrix * o->GetModelMatrix();
 	Vector4 v0, v1;
 	Colour c0, c1;
 	Vector3 t0, t1;
 
+	PIPELINE_STAT(pipelineStats.linesSubmitted += m->numVertices);
+
 	for (uint i = 0; i < m->numVertices; ++i){
-		v0 = mvp * m->vertices[i];
-		v1 = mvp * m->vertices[(i + 1) % m->numVertices];
+		v0 = clipSpace.Position(i);
+		v1 = clipSpace.Position((i + 1) % m->numVertices);
 
 		c0 = m->colours[i];
 		c1 = m->colours[(i + 1) % m->numVertices];
@@ -389,7 +591,8 @@ void SoftwareRasteriser::RasteriseLineLoopMesh(RenderObject*o){
 			m->textureCoords[(i + 1) % m->numVertices].x,
 			m->textureCoords[(i + 1) % m->numVertices].y, 1.0f);
 
-		if (!CohenSutherlandLine(v0,v1, c0 ,c1, t0, t1)){
+		if ((clipSpace.outcodes[i] & clipSpace.outcodes[(i + 1) % m->numVertices]) || !CohenSutherlandLine(v0,v1, c0 ,c1, t0, t1)){
+			PIPELINE_STAT(pipelineStats.linesClipCulled++);
 			continue;
 		}
 
@@ -415,11 +618,35 @@ void SoftwareRasteriser::RasteriseLine(
 	const Colour &colA, const Colour &colB , 
 	const Vector3 &texA , const Vector3 &texB){
 
+	TraceScope scope(trace, binning ? "BinLine" : "RasteriseLine", "raster");
+
 	//transform our ndc coords ito screen coords
 	Vector4 v0 = portMatrix * vertA;
 	Vector4 v1 = portMatrix * vertB;
-	Vector4 dir = v1 - v0; // what direction is the line going?
 
+	if (binning) {
+		BinnedPrimitive p;
+		p.type		= BINNED_LINE;
+		p.v[0]		= v0;
+		p.v[1]		= v1;
+		p.col[0]	= colA;
+		p.col[1]	= colB;
+		p.state		= CurrentRasterState();
+
+		BinPrimitive(p, min(v0.x, v1.x), min(v0.y, v1.y), max(v0.x, v1.x), max(v0.y, v1.y));
+		return;
+	}
+	FillLine(v0, v1, colA, colB, CurrentRasterState());
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	FILL LINE 	********************************
+*///////////////////////////////////////////////////////////
+
+void SoftwareRasteriser::FillLine(const Vector4 &v0, const Vector4 &v1,
+	const Colour &colA, const Colour &colB, const RasterState &state) {
+
+	Vector4 dir = v1 - v0; // what direction is the line going?
 	int xDir = (dir.x < 0.0f) ? -1 : 1;//move left or right?
 	int yDir = (dir.y < 0.0f) ? -1 : 1; //move up or down?
 	int x = (int)v0.x; // current x axis plot point
@@ -459,21 +686,23 @@ void SoftwareRasteriser::RasteriseLine(
 			float t = i*reciprocalRange;
 			Colour currentCol = colB*t + colA*(1.0f - t);
 
-			// added on tut9
-			Vector3 subTex = texA * (t) + texB * (1.0f - (t));
-			subTex.x /= subTex.z;
-			subTex.y /= subTex.z;
-			//end mod from tut9
+			if (x >= state.minX && x <= state.maxX && y >= state.minY && y <= state.maxY) {
+				// added on tut8
+				float zVal = v1.z*(t)+v0.z*(1.0f - (t));
 
-			// added on tut8
-			float zVal = v1.z*(t)+v0.z*(1.0f - (t));
+				if (DepthFunc((int)x, (int)y, zVal)) {
+					PIPELINE_STAT(state.pipelineStats->depthTestsPassed++);
+					PIPELINE_STAT(state.pipelineStats->pixelsBlended++);
+					BlendPixel(x, y, currentCol);
+				}
+				else {
+					PIPELINE_STAT(state.pipelineStats->depthTestsFailed++);
+				}
+				// end mod from tut 8
 
-			if (DepthFunc((int)x, (int)y, zVal)) {
+				PIPELINE_STAT(state.pipelineStats->pixelsBlended++);
 				BlendPixel(x, y, currentCol);
 			}
-			// end mod from tut 8
-
-			BlendPixel(x, y, currentCol);
 			error += absSlope;
 			if (error > 0.5f) {
 				error -= 1.0f;
@@ -483,6 +712,38 @@ void SoftwareRasteriser::RasteriseLine(
 		}
 	}
 
+/*//////////////////////////////////////////////////////////
+//**********	RASTERISE POINT	****************************
+*///////////////////////////////////////////////////////////
+
+void SoftwareRasteriser::RasterisePoint(const Vector4 &v, const Colour &c) {
+	TraceScope scope(trace, binning ? "BinPoint" : "RasterisePoint", "raster");
+
+	Vector4 screenPos = portMatrix * v;
+
+	if (binning) {
+		BinnedPrimitive p;
+		p.type		= BINNED_POINT;
+		p.v[0]		= screenPos;
+		p.col[0]	= c;
+		p.state		= CurrentRasterState();
+
+		BinPrimitive(p, screenPos.x, screenPos.y, screenPos.x, screenPos.y);
+		return;
+	}
+	FillPoint(screenPos, c, CurrentRasterState());
+}
+
+void SoftwareRasteriser::FillPoint(const Vector4 &v, const Colour &c, const RasterState &state) {
+	int x = (int)v.x;
+	int y = (int)v.y;
+
+	if (x >= state.minX && x <= state.maxX && y >= state.minY && y <= state.maxY) {
+		PIPELINE_STAT(state.pipelineStats->pixelsBlended++);
+		BlendPixel(x, y, c);
+	}
+}
+
 /*//////////////////////////////////////////////////////////
 //**********	SHADE PIXEL		****************************
 *///////////////////////////////////////////////////////////
@@ -519,14 +780,14 @@ SoftwareRasteriser::BoundingBox SoftwareRasteriser::CalculateBoxForTri(const Vec
 	box.topLeft.y = max(box.topLeft.y, 0.0f); //screen bound
 
 	box.bottomRight.x = a.x; // start with the first vertex value
-	box.bottomRight.x = min(box.bottomRight.x, b.x); //swap to second if less
-	box.bottomRight.x = min(box.bottomRight.x, c.x); // swap to second if less
-	box.bottomRight.x = max(box.bottomRight.x, screenWidth); //screen bound
+	box.bottomRight.x = max(box.bottomRight.x, b.x); //swap to second if more
+	box.bottomRight.x = max(box.bottomRight.x, c.x); // swap to second if more
+	box.bottomRight.x = min(box.bottomRight.x + 1.0f, (float)screenWidth); //screen bound
 
 	box.bottomRight.y = a.y; // start with the first vertex value
-	box.bottomRight.y = min(box.bottomRight.y, b.y); //swap to second if less
-	box.bottomRight.y = min(box.bottomRight.y, c.y); // swap to second if less
-	box.bottomRight.y = max(box.bottomRight.y, screenWidth); //screen bound
+	box.bottomRight.y = max(box.bottomRight.y, b.y); //swap to second if more
+	box.bottomRight.y = max(box.bottomRight.y, c.y); // swap to second if more
+	box.bottomRight.y = min(box.bottomRight.y + 1.0f, (float)screenHeight); //screen bound
 
 	return box;
 }
@@ -550,16 +811,65 @@ void SoftwareRasteriser::RasteriseTri(const Vector4 &triA, const Vector4 &triB,
 	const Colour &colA, const Colour &colB, const Colour &colC,
 	const Vector3 &texA, const Vector3 &texB, const Vector3 &texC) {
 
+	TraceScope scope(trace, binning ? "BinTriangle" : "RasteriseTri", "raster");
+
 	// incoming triangles are in NDC space
 	Vector4 v0 = portMatrix * triA; // Now in viewport space!
 	Vector4 v1 = portMatrix * triB; // Now in viewport space!
 	Vector4 v2 = portMatrix * triC; // Now in viewport space!
+
+	if (binning) {
+		//tested the same way the tiles would, so a triangle that's only
+		//degenerate once snapped is counted here once, not by every tile
+		if (!IsFrontFacingSnapped(v0, v1, v2)) {
+			PIPELINE_STAT(pipelineStats.trianglesBackFacing++);
+			return; // no point binning back faces
+		}
+		BinnedPrimitive p;
+		p.type		= BINNED_TRI;
+		p.v[0]		= v0;
+		p.v[1]		= v1;
+		p.v[2]		= v2;
+		p.col[0]	= colA;
+		p.col[1]	= colB;
+		p.col[2]	= colC;
+		p.tex[0]	= texA;
+		p.tex[1]	= texB;
+		p.tex[2]	= texC;
+		p.state		= CurrentRasterState();
+
+		BinPrimitive(p,
+			min(v0.x, min(v1.x, v2.x)), min(v0.y, min(v1.y, v2.y)),
+			max(v0.x, max(v1.x, v2.x)), max(v0.y, max(v1.y, v2.y)));
+	}
+	else if (rasteriseMode == RASTERISE_EDGE) {
+		RasteriseTriEdges(v0, v1, v2, colA, colB, colC, texA, texB, texC, CurrentRasterState());
+	}
+	else {
+		RasteriseTriArea(v0, v1, v2, colA, colB, colC, texA, texB, texC);
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	RASTERISE TRIANGLE AREA	********************
+*///////////////////////////////////////////////////////////
+
+void SoftwareRasteriser::RasteriseTriArea(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+	const Colour &colA, const Colour &colB, const Colour &colC,
+	const Vector3 &texA, const Vector3 &texB, const Vector3 &texC) {
+
 	BoundingBox b = CalculateBoxForTri(v0, v1, v2);
 	float triArea = ScreenAreaOfTri(v0, v1, v2);
 	float areaRecip = 1.0f / triArea;
 	float subTriArea[3];
 	Vector4 screenPos(0, 0, 0, 1);
 
+	TexGradients grads;
+	if (currentTexture) {
+		grads = CalculateTexGradients(v0, v1, v2, texA, texB, texC);
+	}
+
+	PIPELINE_STAT(pipelineStats.trianglesBackFacing += (triArea < 0.0f) ? 1 : 0);
 
 	for (float y = b.topLeft.y; y < b.bottomRight.y; ++y) {
 		for (float x = b.topLeft.x; x < b.bottomRight.x; ++x) {
@@ -592,8 +902,10 @@ void SoftwareRasteriser::RasteriseTri(const Vector4 &triA, const Vector4 &triB,
 			// start mods tut 8
 			float zVal = (v0.z * alpha) + (v1.z * beta) + (v2.z * gamma);
  			if (!DepthFunc((int)x, (int)y, zVal)) {
+				PIPELINE_STAT(pipelineStats.depthTestsFailed++);
 				continue;
 			}
+			PIPELINE_STAT(pipelineStats.depthTestsPassed++);
 			//end mods tut 8
 
 
@@ -601,68 +913,446 @@ void SoftwareRasteriser::RasteriseTri(const Vector4 &triA, const Vector4 &triB,
 			if (currentTexture) { 
 				//interpolate in screen linear space
 				Vector3 subTex = (texA * alpha) + (texB * beta) + (texC * gamma);
+				float lod = 0.0f;
+				if (texSampleState == SAMPLE_MIPMAP_NEAREST || texSampleState == SAMPLE_MIPMAP_BILINEAR) {
+					lod = CalculateMipLod(currentTexture, subTex, grads);
+				}
 				//convert the coordinates back into world linear space.
 				subTex.x /= subTex.z;
 				subTex.y /= subTex.z;
 				if (texSampleState == SAMPLE_BILINEAR) {
+					PIPELINE_STAT(pipelineStats.pixelsBlended++);
 					BlendPixel((int)x, (int)y, currentTexture->BilinearTexSample(subTex));
 				} 
 				else if (texSampleState == SAMPLE_NEAREST) {
+					PIPELINE_STAT(pipelineStats.pixelsBlended++);
 					BlendPixel((int)x, (int)y, currentTexture->NearestTexSample(subTex));
 				}
 				else if (texSampleState == SAMPLE_MIPMAP_NEAREST) {
-					float xAlpha, xBeta, xGamma;
-					float yAlpha, yBeta, yGamma;
+					PIPELINE_STAT(pipelineStats.pixelsBlended++);
+					BlendPixel((int)x, (int)y, currentTexture->NearestMipSample(subTex, lod));
+				}
+				else if (texSampleState == SAMPLE_MIPMAP_BILINEAR) {
+					PIPELINE_STAT(pipelineStats.pixelsBlended++);
+					BlendPixel((int)x, (int)y, currentTexture->TrilinearTexSample(subTex, lod));
+				}
+			}
+			else {
+				Colour subColour = ((colA * alpha) + (colB * beta) + (colC * gamma));
+				PIPELINE_STAT(pipelineStats.pixelsBlended++);
+				BlendPixel((uint)x, (uint)y, subColour);
+			}
+			//end mod 10
+		}
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	RASTERISE TRIANGLE EDGES	****************
+*///////////////////////////////////////////////////////////
+
+/*
+Each edge function is twice the signed area of the sub triangle formed by that
+edge and the point p, so dividing it by twice the triangle area gives the
+barycentric weight of the opposite vertex directly. The edge functions are
+linear in x and y, so once they've been evaluated at the corner of the box we
+only need to add a constant to move one pixel along.
+
+Vertices are snapped to 28.4 fixed point first, so the edge functions are
+exact integers. That lets us apply a top-left fill rule: a pixel centre that
+lands exactly on an edge is only filled if that edge is a top or left edge of
+the triangle, so two triangles sharing an edge never both shade the same pixel.
+
+The box is walked in 2x2 quads (or pairs of them), with the coverage, depth
+and weight work for a whole block done at once by the PixelKernel.
+*/
+
+const int SUBPIXEL_BITS = 4;
+const int SUBPIXEL_STEPS = 1 << SUBPIXEL_BITS;
+
+static inline int SnapToSubpixel(float f) {
+	return (int)floor(f * SUBPIXEL_STEPS + 0.5f);
+}
+
+bool SoftwareRasteriser::IsFrontFacingSnapped(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2) {
+	int x0 = SnapToSubpixel(v0.x);
+	int y0 = SnapToSubpixel(v0.y);
+	int x1 = SnapToSubpixel(v1.x);
+	int y1 = SnapToSubpixel(v1.y);
+	int x2 = SnapToSubpixel(v2.x);
+	int y2 = SnapToSubpixel(v2.y);
+	return ((int64_t)(x1 - x0) * (y2 - y0)) - ((int64_t)(y1 - y0) * (x2 - x0)) > 0;
+}
+
+//is the edge a->b a top or left edge of a counter clockwise triangle? Our
+//viewport y axis points up the screen, so left edges are the ones heading
+//down, and top edges are flat ones heading towards -x.
+static inline bool IsTopLeftEdge(int ax, int ay, int bx, int by) {
+	return (by < ay) || (by == ay && bx < ax);
+}
+
+void SoftwareRasteriser::RasteriseTriEdges(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+	const Colour &colA, const Colour &colB, const Colour &colC,
+	const Vector3 &texA, const Vector3 &texB, const Vector3 &texC,
+	const RasterState &state) {
+
+	//snap to the subpixel grid
+	int x0 = SnapToSubpixel(v0.x);
+	int y0 = SnapToSubpixel(v0.y);
+	int x1 = SnapToSubpixel(v1.x);
+	int y1 = SnapToSubpixel(v1.y);
+	int x2 = SnapToSubpixel(v2.x);
+	int y2 = SnapToSubpixel(v2.y);
+
+	int64_t triArea2 = ((int64_t)(x1 - x0) * (y2 - y0)) - ((int64_t)(y1 - y0) * (x2 - x0));
+
+	if (triArea2 <= 0) {
+		//binned triangles were already tested, and counted, when binned
+		PIPELINE_STAT(state.pipelineStats->trianglesBackFacing++);
+		return; // back facing, or has no area to fill
+	}
+
+	TriangleSetup tri;
+
+	//bounding box in whole pixels, clamped to the area we may draw in
+	tri.minX = (min(x0, min(x1, x2)) + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS;
+	tri.minY = (min(y0, min(y1, y2)) + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS;
+	tri.maxX = max(x0, max(x1, x2)) >> SUBPIXEL_BITS;
+	tri.maxY = max(y0, max(y1, y2)) >> SUBPIXEL_BITS;
+
+	tri.minX = max(tri.minX, state.minX);
+	tri.minY = max(tri.minY, state.minY);
+	tri.maxX = min(tri.maxX, state.maxX);
+	tri.maxY = min(tri.maxY, state.maxY);
+
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+		return;
+	}
+
+	//pixel centres that sit exactly on a non top-left edge fail the test
+	tri.edgeBias[0] = IsTopLeftEdge(x1, y1, x2, y2) ? 0 : -1;
+	tri.edgeBias[1] = IsTopLeftEdge(x2, y2, x0, y0) ? 0 : -1;
+	tri.edgeBias[2] = IsTopLeftEdge(x0, y0, x1, y1) ? 0 : -1;
+
+	//per pixel step of each edge function, along x and along y.
+	//edge 0 belongs to v0 so comes from the edge v1->v2, and so on.
+	tri.edgeDx[0] = (int64_t)(y1 - y2) * SUBPIXEL_STEPS;
+	tri.edgeDx[1] = (int64_t)(y2 - y0) * SUBPIXEL_STEPS;
+	tri.edgeDx[2] = (int64_t)(y0 - y1) * SUBPIXEL_STEPS;
+
+	tri.edgeDy[0] = (int64_t)(x2 - x1) * SUBPIXEL_STEPS;
+	tri.edgeDy[1] = (int64_t)(x0 - x2) * SUBPIXEL_STEPS;
+	tri.edgeDy[2] = (int64_t)(x1 - x0) * SUBPIXEL_STEPS;
+
+	tri.areaRecip = 1.0f / (float)triArea2;
+
+	for (int i = 0; i < 3; ++i) {
+		tri.weightDx[i] = tri.edgeDx[i] * tri.areaRecip;
+		tri.weightDy[i] = tri.edgeDy[i] * tri.areaRecip;
+	}
 
-					CalculateWeights(v0, v1, v2, screenPos + Vector4(1, 0, 0, 0), xAlpha, xBeta, xGamma);
-					CalculateWeights(v0, v1, v2, screenPos + Vector4(0, 1, 0, 0), yAlpha, yBeta, yGamma);
+	tri.z[0] = v0.z;
+	tri.z[1] = v1.z;
+	tri.z[2] = v2.z;
 
-					Vector3  xDerivs = (texA * xAlpha) + (texB * xBeta) + (texC * xGamma);
-					Vector3  yDerivs = (texA * yAlpha) + (texB * yBeta) + (texC * yGamma);
-						
-					xDerivs.x /= xDerivs.z;			//return to linear texture space
-					xDerivs.y /= xDerivs.z;
+	//the kernels' interpolated depth can come out a fraction nearer than the
+	//vertices after rounding, so the Hi-Z tests are given a unit of leeway
+	float nearestZ = min(tri.z[0], min(tri.z[1], tri.z[2])) - 1.0f;
 
-					yDerivs.x /= yDerivs.z;
-					yDerivs.y /= yDerivs.z;
+	if (hiZEnabled) {
+		state.stats->trianglesTested++;
+		if (nearestZ >= 0.0f && (uint)nearestZ > hiZ.AreaMax(tri.minX, tri.minY, tri.maxX, tri.maxY)) {
+			state.stats->trianglesCulled++;
+			return; // behind everything already drawn in its box
+		}
+	}
+
+	tri.vertexColour = (state.texture == NULL);
+
+	if (tri.vertexColour) {
+		const Colour* cols[3] = { &colA, &colB, &colC };
+		for (int i = 0; i < 3; ++i) {
+			tri.colour[i][0] = cols[i]->b;
+			tri.colour[i][1] = cols[i]->g;
+			tri.colour[i][2] = cols[i]->r;
+			tri.colour[i][3] = cols[i]->a;
+		}
+	}
+
+	TexGradients grads;
+	if (state.texture) {
+		grads = CalculateTexGradients(v0, v1, v2, texA, texB, texC);
+	}
+
+	tri.depthBuffer = depthBuffer;
+	tri.depthPitch	= screenWidth;
+
+	//very long edges can't be stepped in 32 bit lanes
+	const PixelKernel* kernel = &pixelKernel;
+	for (int i = 0; i < 3; ++i) {
+		if (tri.edgeDx[i] > PIXEL_KERNEL_MAX_STEP || tri.edgeDx[i] < -PIXEL_KERNEL_MAX_STEP ||
+			tri.edgeDy[i] > PIXEL_KERNEL_MAX_STEP || tri.edgeDy[i] < -PIXEL_KERNEL_MAX_STEP) {
+			kernel = &scalarPixelKernel;
+		}
+	}
 
-					xDerivs = xDerivs - subTex; // get the rate of change on the x axis
-					yDerivs = yDerivs - subTex; // get the rate of change on the y axis
+	//quads sit on even pixels, so their derivatives line up between triangles,
+	//and blocks never straddle the edge of a bin tile
+	int startX = tri.minX & ~(kernel->blockWidth - 1);
+	int startY = tri.minY & ~1;
+
+	int px = startX << SUBPIXEL_BITS;
+	int py = startY << SUBPIXEL_BITS;
+
+	int64_t edgeRow[3];
+	edgeRow[0] = ((int64_t)(x2 - x1) * (py - y1)) - ((int64_t)(y2 - y1) * (px - x1));
+	edgeRow[1] = ((int64_t)(x0 - x2) * (py - y2)) - ((int64_t)(y0 - y2) * (px - x2));
+	edgeRow[2] = ((int64_t)(x1 - x0) * (py - y0)) - ((int64_t)(y1 - y0) * (px - x0));
+
+	//depth is linear in screen space, so its nearest point in any box is at a corner
+	float zOrigin = 0.0f;
+	float zDx = 0.0f;
+	float zDy = 0.0f;
+	for (int i = 0; i < 3; ++i) {
+		zOrigin += tri.z[i] * (edgeRow[i] * tri.areaRecip);
+		zDx		+= tri.z[i] * tri.weightDx[i];
+		zDy		+= tri.z[i] * tri.weightDy[i];
+	}
+
+	int64_t blockDx[3];
+	int64_t blockDy[3];
+	for (int i = 0; i < 3; ++i) {
+		blockDx[i] = tri.edgeDx[i] * kernel->blockWidth;
+		blockDy[i] = tri.edgeDy[i] * 2;
+	}
+
+	PixelBlock block;
+
+	//walk the box one Hi-Z block at a time, and the kernel blocks within those.
+	//Hi-Z blocks are a multiple of the kernel block size, so these line up.
+	for (int hiZY = startY & ~(HiZBuffer::BLOCK_SIZE - 1); hiZY <= tri.maxY; hiZY += HiZBuffer::BLOCK_SIZE) {
+		int rowStart	= max(hiZY, startY);
+		int rowEnd		= min(hiZY + HiZBuffer::BLOCK_SIZE - 1, tri.maxY);
+
+		for (int hiZX = startX & ~(HiZBuffer::BLOCK_SIZE - 1); hiZX <= tri.maxX; hiZX += HiZBuffer::BLOCK_SIZE) {
+			int colStart	= max(hiZX, startX);
+			int colEnd		= min(hiZX + HiZBuffer::BLOCK_SIZE - 1, tri.maxX);
 
-					//mpw have the rates of change ont he x and y acis for the tex u and v;
+			if (hiZEnabled) {
+				state.stats->blocksTested++;
 
-					float maxU = max(abs(xDerivs.x), abs(yDerivs.x));
-					float maxV = max(abs(xDerivs.y), abs(yDerivs.y));
+				float z = zOrigin + (zDx * (colStart - startX)) + (zDy * (rowStart - startY));
+				z += min(zDx * (colEnd - colStart), 0.0f);
+				z += min(zDy * (rowEnd - rowStart), 0.0f);
+				z = max(z - 1.0f, nearestZ);
 
-					float maxChange = abs(max(maxU, maxV));
+				if (z >= 0.0f && (uint)z > hiZ.BlockMax(hiZX, hiZY)) {
+					state.stats->blocksCulled++;
+					continue;
+				}
+			}
+
+			int64_t edgeCol[3];
+			for (int i = 0; i < 3; ++i) {
+				edgeCol[i] = edgeRow[i] + (tri.edgeDx[i] * (colStart - startX)) + (tri.edgeDy[i] * (rowStart - startY));
+			}
 
-					int lambda = abs(log(maxChange) / log(2.0));
+			for (int y = rowStart; y <= rowEnd; y += 2) {
+				int64_t edge[3] = { edgeCol[0], edgeCol[1], edgeCol[2] };
 
-					//sample form the usual texture coords, wicth the new LOD
+				for (int x = colStart; x <= colEnd; x += kernel->blockWidth) {
+					kernel->func(tri, x, y, edge, block);
 
-					BlendPixel((int)x, (int)y, currentTexture->NearestTexSample(subTex, lambda));
+					PIPELINE_STAT(state.pipelineStats->depthTestsPassed += PipelineStats::CountLanes(block.mask));
+					PIPELINE_STAT(state.pipelineStats->depthTestsFailed += PipelineStats::CountLanes(block.covered & ~block.mask));
 
+					if (block.mask) {
+						hiZ.MarkWritten(x, y);
+						(this->*state.shade)(*kernel, block, x, y, texA, texB, texC, grads, state);
+					}
 
+					edge[0] += blockDx[0];
+					edge[1] += blockDx[1];
+					edge[2] += blockDx[2];
 				}
+				edgeCol[0] += blockDy[0];
+				edgeCol[1] += blockDy[1];
+				edgeCol[2] += blockDy[2];
+			}
+		}
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	SHADE BLOCK		****************************
+*///////////////////////////////////////////////////////////
+
+template <SoftwareRasteriser::SampleState Sample>
+static inline Colour SampleTexture(Texture* texture, const Vector3 &coords, float lod) {
+	if (Sample == SoftwareRasteriser::SAMPLE_BILINEAR) {
+		return texture->BilinearTexSample(coords);
+	}
+	if (Sample == SoftwareRasteriser::SAMPLE_MIPMAP_NEAREST) {
+		return texture->NearestMipSample(coords, lod);
+	}
+	if (Sample == SoftwareRasteriser::SAMPLE_MIPMAP_BILINEAR) {
+		return texture->TrilinearTexSample(coords, lod);
+	}
+	return texture->NearestTexSample(coords);
+}
+
+template <bool Textured, SoftwareRasteriser::SampleState Sample, bool Blend>
+void SoftwareRasteriser::ShadeBlock(const PixelKernel &kernel, const PixelBlock &block, int x, int y,
+	const Vector3 &texA, const Vector3 &texB, const Vector3 &texC, const TexGradients &grads,
+	const RasterState &state) {
+
+	PIPELINE_STAT(state.pipelineStats->pixelsBlended += PipelineStats::CountLanes(block.mask));
+
+	if (!Textured) {
+		for (int lane = 0; lane < kernel.lanes; ++lane) {
+			if (block.mask & (1 << lane)) {
+				Colour c;
+				c.c = block.colour[lane];
+				WritePixel<Blend>(x + PixelKernel::LaneX(lane), y + PixelKernel::LaneY(lane), c);
+			}
+		}
+		return;
+	}
+
+	Texture* texture = state.texture;
+
+	for (int quad = 0; quad < kernel.lanes; quad += 4) {
+		if (!((block.mask >> quad) & 0xF)) {
+			continue;
+		}
+
+		//interpolate in screen linear space
+		Vector3 quadTex[4];
+		for (int i = 0; i < 4; ++i) {
+			int lane = quad + i;
+			quadTex[i] = (texA * block.alpha[lane]) + (texB * block.beta[lane]) + (texC * block.gamma[lane]);
+		}
+
+		//every pixel in the quad shares the same level of detail
+		float lod = 0.0f;
+		if (Sample == SAMPLE_MIPMAP_NEAREST || Sample == SAMPLE_MIPMAP_BILINEAR) {
+			lod = CalculateMipLod(texture, quadTex[0], grads);
+		}
+
+		//convert the coordinates back into world linear space.
+		for (int i = 0; i < 4; ++i) {
+			quadTex[i].x /= quadTex[i].z;
+			quadTex[i].y /= quadTex[i].z;
+		}
+
+		//bilinear filtering is cheaper for the whole quad at once
+		Colour quadColour[4];
+		if (Sample == SAMPLE_BILINEAR) {
+			texture->BilinearTexSampleBatch(quadTex, 4, quadColour);
+		}
+
+		for (int i = 0; i < 4; ++i) {
+			int lane = quad + i;
+			if (!(block.mask & (1 << lane))) {
+				continue;
+			}
+			int px = x + PixelKernel::LaneX(lane);
+			int py = y + PixelKernel::LaneY(lane);
+
+			if (Sample == SAMPLE_BILINEAR) {
+				WritePixel<Blend>(px, py, quadColour[i]);
 			}
 			else {
-				Colour subColour = ((colA * alpha) + (colB * beta) + (colC * gamma));
-				BlendPixel((uint)x, (uint)y, subColour);
+				WritePixel<Blend>(px, py, SampleTexture<Sample>(texture, quadTex[i], lod));
 			}
-			//end mod 10
 		}
 	}
 }
 
+/*//////////////////////////////////////////////////////////
+//**********	SELECT SHADE BLOCK	************************
+*///////////////////////////////////////////////////////////
+
+template <bool Textured, SoftwareRasteriser::SampleState Sample>
+SoftwareRasteriser::ShadeBlockFunc SoftwareRasteriser::ShadeBlockFor(bool opaque) {
+	if (opaque) {
+		return &SoftwareRasteriser::ShadeBlock<Textured, Sample, false>;
+	}
+	return &SoftwareRasteriser::ShadeBlock<Textured, Sample, true>;
+}
+
+void SoftwareRasteriser::SelectShadeBlock(bool opaque) {
+	if (!currentTexture) {
+		currentShade = ShadeBlockFor<false, SAMPLE_NEAREST>(opaque);
+		return;
+	}
+	switch (texSampleState) {
+	case SAMPLE_BILINEAR:
+		currentShade = ShadeBlockFor<true, SAMPLE_BILINEAR>(opaque);
+		break;
+	case SAMPLE_MIPMAP_NEAREST:
+		currentShade = ShadeBlockFor<true, SAMPLE_MIPMAP_NEAREST>(opaque);
+		break;
+	case SAMPLE_MIPMAP_BILINEAR:
+		currentShade = ShadeBlockFor<true, SAMPLE_MIPMAP_BILINEAR>(opaque);
+		break;
+	default:
+		currentShade = ShadeBlockFor<true, SAMPLE_NEAREST>(opaque);
+		break;
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	CALCULATE TEX GRADIENTS	********************
+*///////////////////////////////////////////////////////////
+
+//Each of the perspective space coordinates is a plane across the screen,
+//so its slope in x and y comes straight from the three viewport vertices
+SoftwareRasteriser::TexGradients SoftwareRasteriser::CalculateTexGradients(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+	const Vector3 &texA, const Vector3 &texB, const Vector3 &texC) {
+	TexGradients g;
+
+	float x10 = v1.x - v0.x;
+	float y10 = v1.y - v0.y;
+	float x20 = v2.x - v0.x;
+	float y20 = v2.y - v0.y;
+
+	float det = (x10 * y20) - (x20 * y10);
+	if (det == 0.0f) {
+		return g; // has no area, so never gets sampled
+	}
+	float detRecip = 1.0f / det;
+
+	Vector3 t10 = texB - texA;
+	Vector3 t20 = texC - texA;
+
+	g.dx = ((t10 * y20) - (t20 * y10)) * detRecip;
+	g.dy = ((t20 * x10) - (t10 * x20)) * detRecip;
+
+	return g;
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	CALCULATE MIP LOD	************************
+*///////////////////////////////////////////////////////////
+
+float SoftwareRasteriser::CalculateMipLod(Texture* texture, const Vector3 &tex, const TexGradients &grads) {
+	float wRecip	= 1.0f / tex.z;
+	float u			= tex.x * wRecip;
+	float v			= tex.y * wRecip;
+
+	//quotient rule, as u = (u/w) / (1/w)
+	float dudx = (grads.dx.x - u * grads.dx.z) * wRecip;
+	float dvdx = (grads.dx.y - v * grads.dx.z) * wRecip;
+	float dudy = (grads.dy.x - u * grads.dy.z) * wRecip;
+	float dvdy = (grads.dy.y - v * grads.dy.z) * wRecip;
+
+	float maxU = max(fabs(dudx), fabs(dudy)) * texture->GetWidth();
+	float maxV = max(fabs(dvdx), fabs(dvdy)) * texture->GetHeight();
+
+	return log2(max(maxU, maxV));
+}
 
-// OUTCODE CONSTANTS
-const int INSIDE_CS = 0;	//000000
-const int LEFT_CS = 1;	//000001
-const int RIGHT_CS = 2;	//000010
-const int BOTTOM_CS = 4;	//000100
-const int TOP_CS = 8;	//001000
-const int NEAR_CS = 16;	//010000
-const int FAR_CS = 32;	//100000
 
 /*//////////////////////////////////////////////////////////
 //**********	HOMOGENOUS OUTCODE	************************
@@ -693,6 +1383,31 @@ int SoftwareRasteriser::HomogenousOutcode(const Vector4 &in) {
 	return outCode;
 }
 
+int SoftwareRasteriser::GuardBandOutcode(const Vector4 &in) const {
+	int outCode = INSIDE_CS;
+
+	if (in.x < -guardBandX * in.w) {
+		outCode |= LEFT_CS;
+	}
+	else if (in.x > guardBandX * in.w) {
+		outCode |= RIGHT_CS;
+	}
+	if (in.y < -guardBandY * in.w) {
+		outCode |= BOTTOM_CS;
+	}
+	else if (in.y > guardBandY * in.w) {
+		outCode |= TOP_CS;
+	}
+	return outCode;
+}
+
+//the guard band reaches GUARD_BAND_PIXELS past each edge of the screen, which
+//is 1 in NDC, plus however much of NDC that many pixels is
+void SoftwareRasteriser::ResizeGuardBand(const Vector3 &halfScreen) {
+	guardBandX = 1.0f + (GUARD_BAND_PIXELS / max(halfScreen.x, 0.5f));
+	guardBandY = 1.0f + (GUARD_BAND_PIXELS / max(halfScreen.y, 0.5f));
+}
+
 /*//////////////////////////////////////////////////////////
 //**********	CLIP EDGE	********************************
 *///////////////////////////////////////////////////////////
@@ -729,7 +1444,8 @@ float SoftwareRasteriser::ClipEdge(const Vector4 &inA, const Vector4 &inB, int a
 *///////////////////////////////////////////////////////////
 
 bool SoftwareRasteriser::CohenSutherlandLine(Vector4 &inA, Vector4 &inB, Colour &colA, Colour &colB, Vector3 &texA, Vector3 &texB) {
-	
+	TraceScope scope(trace, "ClipLine", "clip");
+
 	for (int i = 0; i < 6; ++i) {
 		int planeCode = 1 << i;
 		int outsideA = (HomogenousOutcode(inA) & planeCode);
@@ -760,6 +1476,56 @@ bool SoftwareRasteriser::CohenSutherlandLine(Vector4 &inA, Vector4 &inB, Colour
 	return true;
 }
 
+/*//////////////////////////////////////////////////////////
+//**********	CLIP TRIANGLE	****************************
+*///////////////////////////////////////////////////////////
+
+//Assembles the triangle made of clip space vertices a, b and c, and uses the
+//outcodes the vertex stage worked out to decide whether it needs clipping
+//at all. Most triangles are either entirely inside the clip volume, or
+//entirely outside one of its planes, so only the ones that straddle a
+//plane pay for SutherlandHodgmanTri.
+void SoftwareRasteriser::ClipTriangle(const Colour* colours, const Vector2* textureCoords, uint a, uint b, uint c) {
+	int outA = clipSpace.outcodes[a];
+	int outB = clipSpace.outcodes[b];
+	int outC = clipSpace.outcodes[c];
+
+	PIPELINE_STAT(pipelineStats.trianglesSubmitted++);
+
+	if (outA & outB & outC) { // all outside the same plane, so nothing would survive clipping
+		PIPELINE_STAT(pipelineStats.trianglesTrivialRejected++);
+		return;
+	}
+
+	Vector4 v0 = clipSpace.Position(a);
+	Vector4 v1 = clipSpace.Position(b);
+	Vector4 v2 = clipSpace.Position(c);
+
+	Vector3 t0 = Vector3(textureCoords[a].x, textureCoords[a].y, 1.0f);
+	Vector3 t1 = Vector3(textureCoords[b].x, textureCoords[b].y, 1.0f);
+	Vector3 t2 = Vector3(textureCoords[c].x, textureCoords[c].y, 1.0f);
+
+	//with the guard band, the sides of the screen only need clipping to if a
+	//vertex is so far past one the rasteriser couldn't cope with it
+	int outside		= outA | outB | outC;
+	int mustClip	= outside;
+	if (guardBandEnabled && (outside & ~(NEAR_CS | FAR_CS))) {
+		mustClip = (outside & (NEAR_CS | FAR_CS)) | GuardBandOutcode(v0) | GuardBandOutcode(v1) | GuardBandOutcode(v2);
+	}
+
+	if (mustClip) {
+		SutherlandHodgmanTri(v0, v1, v2, colours[a], colours[b], colours[c], t0, t1, t2, outside);
+		return;
+	}
+	if (outside) {
+		PIPELINE_STAT(pipelineStats.trianglesGuardBanded++);
+	}
+	else {
+		PIPELINE_STAT(pipelineStats.trianglesTrivialAccepted++);
+	}
+	RasteriseInsideTri(v0, v1, v2, colours[a], colours[b], colours[c], t0, t1, t2);
+}
+
 /*//////////////////////////////////////////////////////////
 //**********	SUTHERLAND HODGEMAN TRI	********************
 *///////////////////////////////////////////////////////////
@@ -772,7 +1538,10 @@ void SoftwareRasteriser::SutherlandHodgmanTri(Vector4 &v0, Vector4 &v1, Vector4
 	const Colour &c2,
 	const Vector3 &t0,
 	const Vector3 &t1,
-	const Vector3 &t2) {
+	const Vector3 &t2,
+	int planes) {
+
+	TraceScope scope(trace, "ClipTriangle", "clip");
 
 	Vector4 posIn[MAX_VERTS];
 	Colour colIn[MAX_VERTS];
@@ -794,10 +1563,32 @@ void SoftwareRasteriser::SutherlandHodgmanTri(Vector4 &v0, Vector4 &v1, Vector4
 	texIn[1] = Vector3(t1.x, t1.y, 1);
 	texIn[2] = Vector3(t2.x, t2.y, 1);
 
+	PIPELINE_STAT(pipelineStats.trianglesClipped++);
+
 	int inSize = 3; //keep track of the input list size...
 
-	for (int i = 0; i <= 6; i++) {
-		int planeCode = 1 << i;
+	//near and far first, as clipping to those is what can push the other
+	//vertices out past the guard band
+	static const int planeOrder[6] = { NEAR_CS, FAR_CS, LEFT_CS, RIGHT_CS, BOTTOM_CS, TOP_CS };
+	int guardBandPlanes = -1; //worked out once near and far are done
+
+	for (int i = 0; i < 6 && inSize >= 3; i++) { // one pass per clip plane, until too little is left to make a triangle
+		int planeCode = planeOrder[i];
+
+		if (!(planes & planeCode)) {
+			continue; // nothing is outside this one, and clipping never moves vertices outwards
+		}
+		if (guardBandEnabled && (planeCode & ~(NEAR_CS | FAR_CS))) {
+			if (guardBandPlanes < 0) {
+				guardBandPlanes = INSIDE_CS;
+				for (int j = 0; j < inSize; ++j) {
+					guardBandPlanes |= GuardBandOutcode(posIn[j]);
+				}
+			}
+			if (!(guardBandPlanes & planeCode)) {
+				continue; // left for the rasteriser's bounding box to cut off
+			}
+		}
 
 		Vector4 prevPos = posIn[inSize - 1];
 		Colour prevCol = colIn[inSize - 1];
@@ -837,10 +1628,15 @@ void SoftwareRasteriser::SutherlandHodgmanTri(Vector4 &v0, Vector4 &v1, Vector4
 		}
 		inSize = outSize;
 	} // end of plane clipping loop
+
+	PIPELINE_STAT(pipelineStats.trianglesClipCulled += (inSize < 3) ? 1 : 0);
+	PIPELINE_STAT(pipelineStats.trianglesEmitted += (inSize < 3) ? 0 : inSize - 2);
+
 	for (int i = 0; i < inSize; ++i) {
 		texIn[i] = Vector3(texIn[i].x, texIn[i].y, 1.0f) / posIn[i].w;
 		posIn[i].SelfDivisionByW();
 	}
+	scope.End(); //rasterising is traced on its own
 	for (int i = 2; i < inSize; ++i) {
 		RasteriseTri(
 			posIn[0], posIn[i - 1], posIn[i],
@@ -851,25 +1647,181 @@ void SoftwareRasteriser::SutherlandHodgmanTri(Vector4 &v0, Vector4 &v1, Vector4
 
 } //end of function
 
-  /*//////////////////////////////////////////////////////////
-  //**********	CALCULATE WEIGHTS	**************************
-  *///////////////////////////////////////////////////////////
+/*//////////////////////////////////////////////////////////
+//**********	RASTERISE INSIDE TRI	********************
+*///////////////////////////////////////////////////////////
+
+//For clip space triangles with every vertex inside the clip volume, which
+//SutherlandHodgmanTri would hand on to RasteriseTri untouched
+void SoftwareRasteriser::RasteriseInsideTri(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+	const Colour &c0, const Colour &c1, const Colour &c2,
+	const Vector3 &t0, const Vector3 &t1, const Vector3 &t2) {
 
-void SoftwareRasteriser::CalculateWeights(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2, const Vector4 &p, float &alpha, float &beta, float &gamma) {
-	float triArea = ScreenAreaOfTri(v0, v1, v2);
-	float areaRecip = 1.0f / triArea;
+	PIPELINE_STAT(pipelineStats.trianglesEmitted++);
 
-	float subTriArea[3];
+	Vector4 a = v0;
+	Vector4 b = v1;
+	Vector4 c = v2;
+
+	Vector3 texA = Vector3(t0.x, t0.y, 1.0f) / a.w;
+	Vector3 texB = Vector3(t1.x, t1.y, 1.0f) / b.w;
+	Vector3 texC = Vector3(t2.x, t2.y, 1.0f) / c.w;
 
-	subTriArea[0] = abs(ScreenAreaOfTri(v0, p, v1));
-	subTriArea[1] = abs(ScreenAreaOfTri(v1, p, v2));
-	subTriArea[2] = abs(ScreenAreaOfTri(v2, p, v0));
+	a.SelfDivisionByW();
+	b.SelfDivisionByW();
+	c.SelfDivisionByW();
 
-	alpha = subTriArea[1] * areaRecip;
-	beta = subTriArea[2] * areaRecip;
-	gamma = subTriArea[0] * areaRecip;
+	RasteriseTri(a, b, c, c0, c1, c2, texA, texB, texC);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	CURRENT RASTER STATE	********************
+*///////////////////////////////////////////////////////////
+
+SoftwareRasteriser::RasterState SoftwareRasteriser::CurrentRasterState() {
+	RasterState state;
+	state.texture		= currentTexture;
+	state.sampleState	= texSampleState;
+	state.shade			= currentShade;
+	state.minX			= 0;
+	state.minY			= 0;
+	state.maxX			= (int)screenWidth - 1;
+	state.maxY			= (int)screenHeight - 1;
+	state.stats			= &hiZStats;
+	state.pipelineStats = &pipelineStats;
+	return state;
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	TILE BINNING	****************************
+*///////////////////////////////////////////////////////////
+
+void SoftwareRasteriser::StartTrace() {
+	traceFrame = 0;
+	trace.Start();
+}
+
+void SoftwareRasteriser::SetBinning(bool enabled) {
+	if (binning && !enabled) {
+		RasteriseBins(); //don't lose anything drawn so far
+	}
+	binning = enabled;
+}
+
+void SoftwareRasteriser::SetThreadCount(uint count) {
+	threadCount = count ? count : WorkerPool::DefaultThreadCount();
+
+	delete workers; //made again with the new size when next needed
+	workers = NULL;
+}
+
+void SoftwareRasteriser::ResizeBins() {
+	tilesX = (screenWidth + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (screenHeight + TILE_SIZE - 1) / TILE_SIZE;
+
+	tileHiZStats.clear();
+	tileHiZStats.resize(tilesX * tilesY);
+	tilePipelineStats.clear();
+	tilePipelineStats.resize(tilesX * tilesY);
+
+	binnedPrims.clear();
+	tileBins.clear();
+	tileBins.resize(tilesX * tilesY);
+}
+
+//adds the primitive to the bin of every tile its screen space box touches
+void SoftwareRasteriser::BinPrimitive(const BinnedPrimitive &p, float minX, float minY, float maxX, float maxY) {
+	//points and lines truncate their coordinates, so anything above -1 can still land on pixel 0
+	if (maxX <= -1.0f || maxY <= -1.0f || minX >= screenWidth || minY >= screenHeight) {
+		return;
+	}
 
+	int tileMinX = max((int)minX, 0) / TILE_SIZE;
+	int tileMinY = max((int)minY, 0) / TILE_SIZE;
+	int tileMaxX = min((int)maxX / TILE_SIZE, (int)tilesX - 1);
+	int tileMaxY = min((int)maxY / TILE_SIZE, (int)tilesY - 1);
 
+	uint index = (uint)binnedPrims.size();
+	binnedPrims.push_back(p);
+
+	for (int y = tileMinY; y <= tileMaxY; ++y) {
+		for (int x = tileMinX; x <= tileMaxX; ++x) {
+			tileBins[(y * tilesX) + x].push_back(index);
+		}
+	}
+}
+
+void SoftwareRasteriser::RasteriseBins() {
+	if (binnedPrims.empty()) {
+		return;
+	}
+
+	TraceScope scope(trace, "RasteriseBins", "raster");
+
+	if (!workers) {
+		workers = new WorkerPool(threadCount);
+	}
+
+	//tiles don't overlap, so each can be filled without locking anything
+	workers->Run(tilesX * tilesY, [this](uint tile) {
+		RasteriseTile(tile);
+	});
+
+	for (uint i = 0; i < tileHiZStats.size(); ++i) {
+		hiZStats.Add(tileHiZStats[i]);
+		tileHiZStats[i].Reset();
+		pipelineStats.Add(tilePipelineStats[i]);
+		tilePipelineStats[i].Reset();
+	}
+
+	binnedPrims.clear();
+}
+
+void SoftwareRasteriser::RasteriseTile(uint tile) {
+	vector<uint> &bin = tileBins[tile];
+
+	if (bin.empty()) {
+		return;
+	}
+
+	TraceScope scope(trace, "RasteriseTile", "raster");
+	if (scope.IsRecording()) {
+		std::ostringstream args;
+		args << "\"tile\":" << tile << ",\"primitives\":" << bin.size();
+		scope.SetArgs(args.str());
+	}
+
+	int tileMinX = (tile % tilesX) * TILE_SIZE;
+	int tileMinY = (tile / tilesX) * TILE_SIZE;
+	int tileMaxX = min(tileMinX + TILE_SIZE, (int)screenWidth) - 1;
+	int tileMaxY = min(tileMinY + TILE_SIZE, (int)screenHeight) - 1;
+
+	for (uint i = 0; i < bin.size(); ++i) {
+		const BinnedPrimitive &p = binnedPrims[bin[i]];
+
+		RasterState state = p.state;
+		state.minX = max(state.minX, tileMinX);
+		state.minY = max(state.minY, tileMinY);
+		state.maxX = min(state.maxX, tileMaxX);
+		state.maxY = min(state.maxY, tileMaxY);
+		state.stats = &tileHiZStats[tile]; //so tiles never share counters
+		state.pipelineStats = &tilePipelineStats[tile];
+
+		switch (p.type) {
+		case BINNED_TRI: {
+			RasteriseTriEdges(p.v[0], p.v[1], p.v[2],
+				p.col[0], p.col[1], p.col[2],
+				p.tex[0], p.tex[1], p.tex[2], state);
+		} break;
+		case BINNED_LINE: {
+			FillLine(p.v[0], p.v[1], p.col[0], p.col[1], state);
+		} break;
+		case BINNED_POINT: {
+			FillPoint(p.v[0], p.col[0], state);
+		} break;
+		}
+	}
+	bin.clear();
 }
 
 // GEOFF MODIFICATION END
\ No newline at end of file
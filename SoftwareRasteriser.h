@@ -22,6 +22,12 @@ _-_-_-_-_-_-_-""  ""
 #include "RenderObject.h"
 #include "Common.h"
 #include "Window.h"
+#include "PixelKernel.h"
+#include "WorkerPool.h"
+#include "HiZBuffer.h"
+#include "PipelineStats.h"
+#include "FrameTrace.h"
+#include "VertexTransform.h"
 
 #include <vector>
 
@@ -61,18 +67,124 @@ public://***********************************************************PUBLIC
 		SAMPLE_MIPMAP_BILINEAR
 	};
 
+	void		SetSampleState(SampleState s)	{ texSampleState = s; }
+	SampleState	GetSampleState() const			{ return texSampleState; }
+
 	void SwitchTextureFiltering() {
 		if (texSampleState == SAMPLE_NEAREST) {
 			texSampleState = SAMPLE_BILINEAR;
 		}
 		else if (texSampleState == SAMPLE_BILINEAR) {
 			texSampleState = SAMPLE_MIPMAP_NEAREST;
-		} 
+		}
+		else if (texSampleState == SAMPLE_MIPMAP_NEAREST) {
+			texSampleState = SAMPLE_MIPMAP_BILINEAR;
+		}
 		else {
 			texSampleState = SAMPLE_NEAREST;
 		}
 	}
 
+	//How RasteriseTri walks the pixels of a triangle. AREA is the original
+	//method of summing three sub triangle areas per pixel, EDGE sets up three
+	//fixed point edge functions once per triangle and steps them across the
+	//box, filling shared edges exactly once using a top-left rule.
+	enum RasteriseMode {
+		RASTERISE_AREA,
+		RASTERISE_EDGE
+	};
+
+	void SetRasteriseMode(RasteriseMode mode) {
+		rasteriseMode = mode;
+	}
+
+	RasteriseMode GetRasteriseMode() const {
+		return rasteriseMode;
+	}
+
+	void SwitchRasteriseMode() {
+		rasteriseMode = (rasteriseMode == RASTERISE_AREA) ? RASTERISE_EDGE : RASTERISE_AREA;
+	}
+
+	//Picks the per pixel kernel the edge path uses. Kernels the CPU can't run
+	//fall back to the scalar one; by default the fastest supported is chosen.
+	void SetPixelKernel(PixelKernel::Type type) {
+		pixelKernel = PixelKernel::Create(type);
+	}
+
+	const char* GetPixelKernelName() const {
+		return pixelKernel.name;
+	}
+
+	//...and the vertex stage's transform, picked the same way
+	void SetVertexTransform(VertexTransform::Type type) {
+		vertexTransform = VertexTransform::Create(type);
+	}
+
+	const char* GetVertexTransformName() const {
+		return vertexTransform.name;
+	}
+
+	//In binning mode, DrawObject doesn't fill anything. Its clipped primitives
+	//are recorded into the bins of the screen tiles they touch, and SwapBuffers
+	//fills all the tiles in parallel, each one in the order it was drawn in.
+	//Binned triangles always go down the edge function path.
+	void	SetBinning(bool enabled);
+	bool	IsBinning() const { return binning; }
+
+	void	SwitchBinning() {
+		SetBinning(!binning);
+	}
+
+	//How many threads (including the calling one) fill tiles in binning mode.
+	//0 uses one per hardware thread.
+	void	SetThreadCount(uint count);
+	uint	GetThreadCount() const { return threadCount; }
+
+	//Tiles line up with the Hi-Z buffer's, so threads never share its blocks
+	static const int TILE_SIZE = HiZBuffer::TILE_SIZE;
+
+	//Hi-Z culling skips 8x8 blocks, and whole triangles, that are further
+	//away than everything already drawn there. It changes nothing on screen.
+	void	SetHiZ(bool enabled) { hiZEnabled = enabled; }
+	bool	IsHiZ() const { return hiZEnabled; }
+
+	void	SwitchHiZ() {
+		hiZEnabled = !hiZEnabled;
+	}
+
+	//With the guard band on, triangles are only clipped against the near and
+	//far planes, and the edges of the screen are left to the rasteriser's
+	//bounding box - as long as none of their vertices are further than
+	//GUARD_BAND_PIXELS off screen, which keeps their edge functions within
+	//what the SIMD kernels can step. Clipped edges land exactly on the centres
+	//of the bottom row and right hand column of pixels, which the fill rule
+	//leaves empty, so those are filled in with it on and not without it.
+	void	SetGuardBand(bool enabled) { guardBandEnabled = enabled; }
+	bool	IsGuardBand() const { return guardBandEnabled; }
+
+	void	SwitchGuardBand() {
+		guardBandEnabled = !guardBandEnabled;
+	}
+
+	static const int GUARD_BAND_PIXELS = 8192;
+
+	//Counted since the last ClearBuffers. In binning mode a triangle is tested
+	//once for every tile it lands in.
+	const HiZStats&	GetHiZStats() const { return hiZStats; }
+
+	//Also counted since the last ClearBuffers, but only in builds with
+	//SR_PIPELINE_STATS defined - see PipelineStats.h. Binned primitives count
+	//their pixels when SwapBuffers fills them.
+	const PipelineStats&	GetPipelineStats() const { return pipelineStats; }
+
+	//Records how long ClearBuffers, each DrawObject - and the clipping and
+	//rasterising of each primitive in it - and SwapBuffers take, on every
+	//thread, until StopTrace writes it all out as a Chrome trace JSON file.
+	void	StartTrace();
+	bool	StopTrace(const string &filename) { return trace.Stop(filename); }
+	bool	IsTracing() const { return trace.IsRecording(); }
+
 	// GEOFF MODIFICATION END
 
 	
@@ -81,8 +193,14 @@ protected://***********************************************************PROTECTED
 	
 	
 	SampleState texSampleState = SAMPLE_NEAREST;
+	RasteriseMode rasteriseMode = RASTERISE_EDGE;
+	PixelKernel pixelKernel;
+	PixelKernel scalarPixelKernel;
 	Colour*	GetCurrentBuffer();
 	Texture* currentTexture;
+	bool	cullMeshlets;	//whether this draw goes a meshlet at a time
+	void	TransformMesh(RenderObject*o);
+	void	DrawStreamingObject(RenderObject* o);
 	void	RasterisePointsMesh(RenderObject*o);
 	void	RasteriseLinesMesh(RenderObject*o);
 
@@ -92,9 +210,51 @@ protected://***********************************************************PROTECTED
 		const Colour &colA = Colour(), const Colour &colB = Colour(), 
 		const Vector3 &texA = Vector3() , const Vector3 &texB = Vector3());
 
+	void	RasterisePoint(const Vector4 &v, const Colour &c);
+
+	struct RasterState;
+
+	//How a triangle's perspective space texture coordinates (u/w, v/w, 1/w)
+	//change from one pixel to the next, across and up the screen. They're
+	//the same everywhere on the triangle, so are worked out once for it.
+	struct TexGradients {
+		Vector3	dx;
+		Vector3	dy;
+	};
+
+	//One permutation of ShadeBlock - see SelectShadeBlock
+	typedef void (SoftwareRasteriser::*ShadeBlockFunc)(const PixelKernel &kernel, const PixelBlock &block, int x, int y,
+		const Vector3 &texA, const Vector3 &texB, const Vector3 &texC, const TexGradients &grads,
+		const RasterState &state);
+
+	//Everything needed to fill a primitive besides its vertices, captured when
+	//it is drawn so that binned primitives can be filled later on. Only pixels
+	//inside the min / max box are ever touched.
+	struct RasterState {
+		Texture*	texture;
+		SampleState	sampleState;
+		ShadeBlockFunc	shade;	//how the edge path colours the pixels it covers
+		int			minX;
+		int			minY;
+		int			maxX;
+		int			maxY;
+		HiZStats*	stats;	//where the Hi-Z tests count their work
+		PipelineStats*	pipelineStats;	//...and the pixel stages theirs
+	};
+
+	RasterState	CurrentRasterState();
+
+	void	FillLine(const Vector4 &v0, const Vector4 &v1, const Colour &colA, const Colour &colB, const RasterState &state);
+	void	FillPoint(const Vector4 &v, const Colour &c, const RasterState &state);
+
 	inline void	ShadePixel(uint x, uint y, const Colour&c);
 
 	void	RasteriseTriMesh(RenderObject*o);
+	bool	CanCullMeshlets(RenderObject *o) const;
+	void	RasteriseMeshlets(RenderObject *o);
+	void	RasteriseIndexedTriMesh(RenderObject *o);
+	template <typename Index>
+	void	RasteriseIndexedTris(RenderObject *o, const Index* indices);
 	void	RasteriseTriFanMesh(RenderObject *o);
 	void	RasteriseTriStripMesh(RenderObject *o);
 
@@ -126,21 +286,126 @@ protected://***********************************************************PROTECTED
 		const Colour &colA = Colour(), const Colour &colB = Colour(), const Colour &colC = Colour(),
 		const Vector3 &texA = Vector3(), const Vector3 &texB = Vector3(), const Vector3 &texC = Vector3());
 
+	void RasteriseTriArea(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+		const Colour &colA, const Colour &colB, const Colour &colC,
+		const Vector3 &texA, const Vector3 &texB, const Vector3 &texC);
+
+	//whether the triangle still faces us, with some area, once its vertices
+	//are snapped to the subpixel grid RasteriseTriEdges works on
+	static bool	IsFrontFacingSnapped(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2);
+
+	void RasteriseTriEdges(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+		const Colour &colA, const Colour &colB, const Colour &colC,
+		const Vector3 &texA, const Vector3 &texB, const Vector3 &texC,
+		const RasterState &state);
+
+	//Colours the pixels of a block the kernel found covered and in front.
+	//Every combination of texturing, sample state and blending is compiled
+	//separately, so nothing in here branches on any of them, and the one
+	//each draw needs is picked before it starts.
+	template <bool Textured, SampleState Sample, bool Blend>
+	void ShadeBlock(const PixelKernel &kernel, const PixelBlock &block, int x, int y,
+		const Vector3 &texA, const Vector3 &texB, const Vector3 &texC, const TexGradients &grads,
+		const RasterState &state);
+
+	//Picks the ShadeBlock for the current texture and sample state. Blending
+	//is left out if everything being drawn is known to be opaque.
+	void SelectShadeBlock(bool opaque);
+
+	template <bool Textured, SampleState Sample>
+	static ShadeBlockFunc ShadeBlockFor(bool opaque);
+
+	ShadeBlockFunc	currentShade;
+
+	/*//////////////////////////////////////////////////////////
+	//**********	TILE BINNING	****************************
+	*///////////////////////////////////////////////////////////
+
+	enum BinnedType {
+		BINNED_POINT,
+		BINNED_LINE,
+		BINNED_TRI
+	};
+
+	struct BinnedPrimitive {
+		BinnedType	type;
+		Vector4		v[3];	//viewport space
+		Colour		col[3];
+		Vector3		tex[3];
+		RasterState	state;
+	};
+
+	void	ResizeBins();
+	void	BinPrimitive(const BinnedPrimitive &p, float minX, float minY, float maxX, float maxY);
+	void	RasteriseBins();
+	void	RasteriseTile(uint tile);
+
+	bool					binning;
+	uint					threadCount;
+	WorkerPool*				workers;
+
+	uint					tilesX;
+	uint					tilesY;
+	vector<BinnedPrimitive>	binnedPrims;
+	vector<vector<uint> >	tileBins;	//indices into binnedPrims, in draw order
+	vector<HiZStats>		tileHiZStats;
+	vector<PipelineStats>	tilePipelineStats;
+
+	bool					hiZEnabled;
+	bool					guardBandEnabled;
+	float					guardBandX;	//how far the guard band reaches, in multiples of clip space w
+	float					guardBandY;
+	HiZBuffer				hiZ;
+	HiZStats				hiZStats;
+
+	PipelineStats			pipelineStats;
+
+	VertexTransform			vertexTransform;
+	ClipSpaceBuffer			clipSpace;	//the current draw's vertices, from TransformMesh
+
+	FrameTrace				trace;
+	uint					traceFrame;	//counted from StartTrace
+	uint					traceDraw;	//counted from ClearBuffers
+
+	static TexGradients CalculateTexGradients(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+		const Vector3 &texA, const Vector3 &texB, const Vector3 &texC);
+
+	//log2 of how many texels of the full size texture one pixel covers, at
+	//the perspective space texture coordinate tex
+	static float CalculateMipLod(Texture* texture, const Vector3 &tex, const TexGradients &grads);
+
 	bool CohenSutherlandLine( Vector4 &inA, Vector4 &inB, Colour &colA, Colour &colB, Vector3 &texA, Vector3 &texB ) ;
 
+	void ClipTriangle(Mesh* m, uint a, uint b, uint c) {
+		ClipTriangle(m->colours, m->textureCoords, a, b, c);
+	}
+
+	//a, b and c index clipSpace, colours and textureCoords alike
+	void ClipTriangle(const Colour* colours, const Vector2* textureCoords, uint a, uint b, uint c);
+
+	//planes is every clip plane any of the vertices are outside of
 	void SutherlandHodgmanTri(Vector4 &v0, Vector4 &v1, Vector4 &v2,
 		const Colour &c0 = Colour(),
 		const Colour &c1 = Colour(), 
 		const Colour &c2 = Colour(), 
 		const Vector3 &t0 = Vector3(),
 		const Vector3 &t1 = Vector3(), 
-		const Vector3 &t2 = Vector3());
+		const Vector3 &t2 = Vector3(),
+		int planes = ALL_CS);
+
+	void RasteriseInsideTri(const Vector4 &v0, const Vector4 &v1, const Vector4 &v2,
+		const Colour &c0, const Colour &c1, const Colour &c2,
+		const Vector3 &t0, const Vector3 &t1, const Vector3 &t2);
 
 	float ClipEdge(const Vector4 &inA, const Vector4 &inB, int axis);
 
 	int HomogenousOutcode(const Vector4 &in);
 
-	void CalculateWeights(const Vector4 &a, const Vector4 &b, const Vector4 &c, const Vector4 &p, float &alpha, float &beta, float &gamma);
+	//like HomogenousOutcode, for the edges of the guard band rather than the screen
+	int GuardBandOutcode(const Vector4 &in) const;
+
+	void ResizeGuardBand(const Vector3 &halfScreen);
+
 	
 	/*//////////////////////////////////////////////////////////
 	//**********	INLINE: BLENDPIXEL	********************
@@ -170,6 +435,19 @@ protected://***********************************************************PROTECTED
 	}
 
 
+	//For pixels already known to be on screen. Blending a source with an
+	//alpha of 255 just copies it, so that is all the opaque version does.
+	template <bool Blend>
+	inline void WritePixel(int x, int y, const Colour &source) {
+		if (Blend) {
+			BlendPixel(x, y, source);
+			return;
+		}
+		Colour &dest = buffers[currentDrawBuffer][(y*screenWidth) + x];
+		dest	= source;
+		dest.a	= 255;
+	}
+
 	/*//////////////////////////////////////////////////////////
 	//**********	INLINE: DEPTH FUNC	********************************
 	*///////////////////////////////////////////////////////////
@@ -183,6 +461,7 @@ protected://***********************************************************PROTECTED
 			return false;
 		}
 		depthBuffer[index] = castVal;
+		hiZ.MarkWritten(x, y);
 		return true;
 	}
 };
@@ -0,0 +1,149 @@
+#include "StreamingMesh.h"
+#include "MeshFile.h"
+
+static const uint NO_CHUNK = 0xFFFFFFFF;
+
+StreamingMesh::StreamingMesh() {
+	type				= PRIMITIVE_TRIANGLES;
+	numVertices			= 0;
+	chunkVertices		= 0;
+	chunkCount			= 0;
+	verticesOffset		= 0;
+	coloursOffset		= 0;
+	textureCoordsOffset	= 0;
+
+	for (int i = 0; i < 2; ++i) {
+		chunks[i]		= NULL;
+		chunkLoaded[i]	= NO_CHUNK;
+	}
+
+	handedOut	= 0;
+	loaded		= 0;
+	good		= true;
+	quit		= false;
+}
+
+StreamingMesh::~StreamingMesh() {
+	if (loader.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wakeLoader.notify_all();
+		loader.join();
+	}
+	delete chunks[0];
+	delete chunks[1];
+}
+
+StreamingMesh* StreamingMesh::Open(const string &filename, uint chunkVertices) {
+	StreamingMesh* s = new StreamingMesh();
+
+	s->file.open(filename.c_str(), std::ios::binary);
+	s->file.seekg(0, std::ios::end);
+	uint64_t fileSize = (uint64_t)(std::streamoff)s->file.tellg();
+	s->file.seekg(0, std::ios::beg);
+
+	MeshFileHeader header;
+	if (!s->file || fileSize < sizeof(header) ||
+		!s->file.read((char*)&header, sizeof(header)) ||
+		!IsValidMeshFileHeader(header, fileSize) ||
+		header.numIndices || header.numVertices == 0 ||
+		(header.type != PRIMITIVE_POINTS && header.type != PRIMITIVE_LINES && header.type != PRIMITIVE_TRIANGLES)) {
+		delete s;
+		return NULL;
+	}
+
+	s->type					= (PrimitiveType)header.type;
+	s->numVertices			= header.numVertices;
+	s->verticesOffset		= header.verticesOffset;
+	s->coloursOffset		= header.coloursOffset;
+	s->textureCoordsOffset	= header.textureCoordsOffset;
+
+	s->chunkVertices	= min(max(chunkVertices - (chunkVertices % 6), 6u), s->numVertices);
+	s->chunkCount		= (s->numVertices + s->chunkVertices - 1) / s->chunkVertices;
+
+	for (int i = 0; i < 2; ++i) {
+		Mesh* m				= new Mesh();
+		m->type				= s->type;
+		m->vertices			= new Vector4[s->chunkVertices];
+		m->colours			= new Colour[s->chunkVertices];
+		m->textureCoords	= new Vector2[s->chunkVertices];
+		s->chunks[i]		= m;
+	}
+
+	s->loader = std::thread(&StreamingMesh::LoaderLoop, s);
+	return s;
+}
+
+size_t StreamingMesh::GetResidentBytes() const {
+	return 2 * (size_t)chunkVertices * (sizeof(Vector4) + sizeof(Colour) + sizeof(Vector2));
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	NEXT CHUNK	********************************
+*///////////////////////////////////////////////////////////
+
+Mesh* StreamingMesh::NextChunk() {
+	uint64_t n;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		n = handedOut;
+		chunkReady.wait(lock, [this, n] { return loaded > n; });
+		handedOut = n + 1;
+	}
+	//whoever had the chunk before this one is done with it, so the loader
+	//can fill it with the one after
+	wakeLoader.notify_one();
+	return chunks[n % 2];
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	LOADER	************************************
+*///////////////////////////////////////////////////////////
+
+void StreamingMesh::LoaderLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		//chunk n can only be loaded once chunk n - 2, which was in the same
+		//chunk mesh, has been finished with - when chunk n - 1 is handed out
+		wakeLoader.wait(lock, [this] { return quit || loaded < 2 || loaded <= handedOut; });
+		if (quit) {
+			return;
+		}
+		uint64_t n = loaded;
+		lock.unlock();
+
+		uint slot	= (uint)(n % 2);
+		uint chunk	= (uint)(n % chunkCount);
+		bool ok		= true;
+		if (chunkLoaded[slot] != chunk) {
+			ok = ReadChunk(chunk, chunks[slot]);
+			chunkLoaded[slot] = ok ? chunk : NO_CHUNK;
+		}
+
+		lock.lock();
+		if (!ok) {
+			good = false;
+		}
+		loaded = n + 1;
+		chunkReady.notify_all();
+	}
+}
+
+bool StreamingMesh::ReadChunk(uint chunk, Mesh* into) {
+	uint first = chunk * chunkVertices;
+	uint count = min(chunkVertices, numVertices - first);
+
+	file.clear();
+	file.seekg((std::streamoff)(verticesOffset + (uint64_t)first * sizeof(Vector4)));
+	file.read((char*)into->vertices, count * sizeof(Vector4));
+	file.seekg((std::streamoff)(coloursOffset + (uint64_t)first * sizeof(Colour)));
+	file.read((char*)into->colours, count * sizeof(Colour));
+	file.seekg((std::streamoff)(textureCoordsOffset + (uint64_t)first * sizeof(Vector2)));
+	file.read((char*)into->textureCoords, count * sizeof(Vector2));
+
+	into->numVertices = file ? count : 0;
+	into->UpdateOpaque();
+	return into->numVertices != 0;
+}
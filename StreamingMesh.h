@@ -0,0 +1,88 @@
+/******************************************************************************
+Class:StreamingMesh
+Implements:
+Author:Geoff Whitehead
+Description:A binary .srmesh file that's never loaded all at once. Its
+vertices are read from disk a fixed sized chunk at a time, into one of two
+chunk meshes, while the other is drawn - so however big the file is, only
+two chunks' worth of it are ever in memory.
+
+A thread of its own reads ahead: as soon as a chunk is handed out by
+NextChunk, the one after it starts loading into the other chunk mesh. The
+chunks go round and round, so after the last one comes the first again,
+and the start of the next frame is read in while this one is finishing.
+
+Only lists can be cut up like this - points, lines and triangles, without
+indices, which could point anywhere in the file.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+class StreamingMesh {
+public:
+	//chunkVertices is rounded down to a multiple of 6, so every chunk holds
+	//whole lines and triangles. NULL if the file can't be read, or isn't a
+	//mesh that can be streamed.
+	static StreamingMesh*	Open(const string &filename, uint chunkVertices = DEFAULT_CHUNK_VERTICES);
+
+	~StreamingMesh();
+
+	//Waits for the next chunk to finish loading, and starts loading the one
+	//after it. The chunk stays as it is until the next call.
+	Mesh*			NextChunk();
+
+	PrimitiveType	GetType() const			{ return type; }
+	uint			GetNumVertices() const	{ return numVertices; }
+	uint			GetChunkVertices() const	{ return chunkVertices; }
+	uint			GetChunkCount() const	{ return chunkCount; }
+
+	//what the two chunk meshes take up between them
+	size_t			GetResidentBytes() const;
+
+	//false once a chunk couldn't be read; it, and any after it, are empty
+	bool			IsGood() const	{ return good; }
+
+	static const uint DEFAULT_CHUNK_VERTICES = 65532;
+
+protected:
+	StreamingMesh();
+
+	void			LoaderLoop();
+	bool			ReadChunk(uint chunk, Mesh* into);
+
+	std::ifstream	file;	//only the loader thread touches this after Open
+
+	PrimitiveType	type;
+	uint			numVertices;
+	uint			chunkVertices;
+	uint			chunkCount;
+
+	uint64_t		verticesOffset;
+	uint64_t		coloursOffset;
+	uint64_t		textureCoordsOffset;
+
+	Mesh*			chunks[2];		//chunk number n is always loaded into chunks[n % 2]
+	uint			chunkLoaded[2];	//which of the file's chunks each holds, so they're only read once if there's no more than 2
+
+	std::thread				loader;
+	std::mutex				mutex;
+	std::condition_variable	wakeLoader;
+	std::condition_variable	chunkReady;
+
+	//chunks are numbered from the first ever handed out, not from the start
+	//of the file, and keep counting up as the file goes round
+	uint64_t		handedOut;	//how many NextChunk has returned
+	uint64_t		loaded;		//...and how many the loader has finished
+	std::atomic<bool>	good;
+	bool			quit;
+};
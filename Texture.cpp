@@ -1,48 +1,359 @@
 #include "Texture.h"
+#include "CPUFeatures.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <cstdlib>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+//SSE2 is there on every x86 processor the rasteriser can run on, so unlike
+//the pixel kernels, the bilinear filter doesn't bother checking for it
+#ifdef SR_X86
+#define TEXTURE_SSE2
+#include <emmintrin.h>
+#endif
+
+//tiled levels start on a cache line, so each 4x4 block of texels is one
+static Colour* AlignedAlloc(size_t bytes) {
+#ifdef _MSC_VER
+	return (Colour*)_aligned_malloc(bytes, 64);
+#else
+	void* p = NULL;
+	return posix_memalign(&p, 64, bytes) ? NULL : (Colour*)p;
+#endif
+}
+
+static void AlignedFree(Colour* p) {
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
 
 Texture::Texture(void)	{
 	width	= 0;
 	height	= 0;
 
 	texels = NULL;
+	opaque = false;
+	layout = TEXELS_LINEAR;
+	file   = NULL;
+
+	contentHash			= 0;
+	contentHashKnown	= false;
 }
 
 Texture::~Texture(void)	{
-	delete[] texels;
+	FreeMipMaps();
+	FreeTexels();
+	delete file;
+}
+
+void Texture::FreeTexels() {
+	if (!IsMapped(texels)) {
+		if (layout == TEXELS_TILED) {
+			AlignedFree(texels);
+		}
+		else {
+			delete[] texels;
+		}
+	}
+	texels = NULL;
+}
+
+bool Texture::IsMapped(const Colour* p) const {
+	return file && file->Contains(p);
+}
+
+void Texture::SetTexelLayout(TexelLayout l) {
+	if (l == layout) {
+		return;
+	}
+	if (!texels) {
+		layout = l;
+		return;
+	}
+
+	//the mip levels are always built from the texels row by row
+	Colour* rows = texels;
+	if (layout == TEXELS_TILED) {
+		rows = new Colour[(size_t)width * height];
+		for (uint y = 0; y < height; ++y) {
+			for (uint x = 0; x < width; ++x) {
+				rows[(y * width) + x] = texels[TiledIndex(x, y, width)];
+			}
+		}
+	}
+
+	FreeMipMaps();
+	if (rows != texels) {
+		FreeTexels();
+	}
+	texels	= rows;
+	layout	= l;
+	CreateMipMaps();
 }
 
+/*//////////////////////////////////////////////////////////
+//**********	TGA FILES	********************************
+*///////////////////////////////////////////////////////////
+
+static const size_t TGA_HEADER_SIZE = 18;
+
 Texture* Texture::TextureFromTGA(const string &filename) {
 	
 	Texture * t = new Texture();
-	
-	std::ifstream file;
 
 	std::cout << "Loading TGA from(" << filename << ")" << std::endl;
-	file.open(filename.c_str(), std::ios::binary);
-	if(!file.is_open()){
+	MappedFile* file = MappedFile::Open(filename);
+	if (!file || file->GetSize() < TGA_HEADER_SIZE) {
 		std::cout << "TextureFromTGA file error" << std::endl;
-		return t ;
+		delete file;
+		return t;
 	}
 
-	unsigned char TGAheader[18];
-
-	std::cout << "sizeof(TGAheader) is " << sizeof(TGAheader) << std::endl;
-
-	file.read((char*)TGAheader,sizeof(TGAheader));
+	const unsigned char* TGAheader = file->GetData();
 
 	t->width	= (TGAheader[12] + (TGAheader[13] << 8));
 	t->height	= (TGAheader[14] + (TGAheader[15] << 8));
 
-	int size = t->width * t->height * (TGAheader[16] / 8);
+	size_t bytesPerTexel = max(TGAheader[16] / 8, 1);
 
-	t->texels = new Colour[t->width*t->height];
+	//the texels come after the image ID and colour map, if there are either
+	size_t offset = TGA_HEADER_SIZE + TGAheader[0];
+	if (TGAheader[1]) {
+		offset += (TGAheader[5] + (TGAheader[6] << 8)) * ((TGAheader[7] + 7) / 8);
+	}
+
+	size_t count		= (size_t)t->width * t->height;
+	size_t available	= (file->GetSize() > offset) ? (file->GetSize() - offset) / bytesPerTexel : 0;
+	const unsigned char* source = file->GetData() + offset;
+
+	if (bytesPerTexel == sizeof(Colour) && available >= count && (offset % sizeof(Colour)) == 0) {
+		//already just as we'd lay them out, so they're used where they are
+		t->texels	= (Colour*)source;
+		t->file		= file;
+	}
+	else {
+		//the texels of most TGAs start 18 bytes in, so aren't aligned well
+		//enough to use in place, and get copied out
+		t->texels = new Colour[count];
+		count = min(count, available);
+
+		if (bytesPerTexel == sizeof(Colour)) {
+			memcpy(t->texels, source, count * sizeof(Colour));
+		}
+		else if (bytesPerTexel == 3) {
+			for (size_t i = 0; i < count; ++i) {
+				t->texels[i].b = source[i * 3];
+				t->texels[i].g = source[i * 3 + 1];
+				t->texels[i].r = source[i * 3 + 2];
+			}
+		}
+		delete file;
+	}
 
-	file.read( (char*) t->texels ,size);
-	file.close();
 	t->CreateMipMaps();
 	return t;
 }
 
+/*//////////////////////////////////////////////////////////
+//**********	MIP FILES	********************************
+*///////////////////////////////////////////////////////////
+
+//Everything after the header starts on a 64 byte boundary, so once mapped
+//every level is aligned to a cache line, and every tile of a tiled level too
+static const char		MIP_FILE_MAGIC[4]		= { 'S', 'R', 'M', 'P' };
+static const uint32_t	MIP_FILE_VERSION		= 1;
+static const uint32_t	MIP_FILE_MAX_LEVELS		= 32;
+static const size_t		MIP_FILE_ALIGNMENT		= 64;
+static const string		MIP_FILE_EXTENSION		= ".srmip";
+
+struct MipFileHeader {
+	char		magic[4];
+	uint32_t	version;
+	uint32_t	width;
+	uint32_t	height;
+	uint32_t	levels;
+	uint32_t	layout;
+	uint32_t	opaque;
+	uint32_t	reserved;
+	uint64_t	contentHash;
+	uint64_t	texelsOffset;	//the full size texture, so level 0
+	uint64_t	levelOffsets[MIP_FILE_MAX_LEVELS];	//in the layout above
+};
+
+//how many levels CreateMipMaps would build
+static uint32_t MipLevelCount(uint width, uint height) {
+	uint32_t levels = 1;
+	while (width > 1 && height > 1) {
+		width	>>= 1;
+		height	>>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+static bool InMipFile(const MappedFile* file, uint64_t at, uint64_t bytes) {
+	return (at % MIP_FILE_ALIGNMENT) == 0 && at <= file->GetSize() && bytes <= file->GetSize() - at;
+}
+
+static size_t AlignToMipFile(size_t offset) {
+	return (offset + MIP_FILE_ALIGNMENT - 1) & ~(MIP_FILE_ALIGNMENT - 1);
+}
+
+bool Texture::SaveMipFile(const string &filename) const {
+	if (!texels || mipLevels.size() > MIP_FILE_MAX_LEVELS) {
+		return false;
+	}
+
+	MipFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MIP_FILE_MAGIC, sizeof(header.magic));
+	header.version		= MIP_FILE_VERSION;
+	header.width		= width;
+	header.height		= height;
+	header.levels		= (uint32_t)mipLevels.size();
+	header.layout		= layout;
+	header.opaque		= opaque ? 1 : 0;
+	header.contentHash	= contentHashKnown ? contentHash : const_cast<Texture*>(this)->GetContentHash();
+
+	size_t offset = AlignToMipFile(sizeof(header));
+	header.texelsOffset = offset;
+	offset = AlignToMipFile(offset + LevelTexelCount(0) * sizeof(Colour));
+
+	for (uint i = 0; i < mipLevels.size(); ++i) {
+		if (mipLevels[i] == texels) {
+			header.levelOffsets[i] = header.texelsOffset; // stored once
+			continue;
+		}
+		header.levelOffsets[i] = offset;
+		offset = AlignToMipFile(offset + LevelTexelCount(i) * sizeof(Colour));
+	}
+
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	if (!out.is_open()) {
+		return false;
+	}
+
+	const char padding[MIP_FILE_ALIGNMENT] = { 0 };
+	size_t written = 0;
+
+	//pads out to offset, then writes the data there
+	auto WriteAt = [&](size_t at, const void* data, size_t bytes) {
+		out.write(padding, at - written);
+		out.write((const char*)data, bytes);
+		written = at + bytes;
+	};
+
+	WriteAt(0, &header, sizeof(header));
+	WriteAt(header.texelsOffset, texels, LevelTexelCount(0) * sizeof(Colour));
+	for (uint i = 0; i < mipLevels.size(); ++i) {
+		if (mipLevels[i] != texels) {
+			WriteAt(header.levelOffsets[i], mipLevels[i], LevelTexelCount(i) * sizeof(Colour));
+		}
+	}
+	out.write(padding, offset - written);
+
+	return out.good();
+}
+
+Texture* Texture::TextureFromMipFile(const string &filename) {
+	Texture * t = new Texture();
+
+	std::cout << "Loading mip chain from(" << filename << ")" << std::endl;
+	MappedFile* file = MappedFile::Open(filename);
+	if (!file || file->GetSize() < sizeof(MipFileHeader)) {
+		std::cout << "TextureFromMipFile file error" << std::endl;
+		delete file;
+		return t;
+	}
+
+	MipFileHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+
+	bool valid = !memcmp(header.magic, MIP_FILE_MAGIC, sizeof(header.magic)) &&
+		header.version == MIP_FILE_VERSION &&
+		header.layout <= TEXELS_TILED &&
+		header.width > 0 && header.height > 0 &&
+		header.levels == MipLevelCount(header.width, header.height);
+
+	t->width	= header.width;
+	t->height	= header.height;
+	t->layout	= (TexelLayout)header.layout;
+
+	//every level has to be aligned, and all there
+	valid = valid && InMipFile(file, header.texelsOffset, t->LevelTexelCount(0) * sizeof(Colour));
+	for (uint32_t i = 0; valid && i < header.levels; ++i) {
+		valid = InMipFile(file, header.levelOffsets[i], t->LevelTexelCount(i) * sizeof(Colour));
+	}
+
+	if (!valid) {
+		std::cout << "TextureFromMipFile isn't a mip file this version can read" << std::endl;
+		t->width	= 0;
+		t->height	= 0;
+		t->layout	= TEXELS_LINEAR;
+		delete file;
+		return t;
+	}
+
+	const unsigned char* data = file->GetData();
+
+	t->file		= file;
+	t->texels	= (Colour*)(data + header.texelsOffset);
+	for (uint32_t i = 0; i < header.levels; ++i) {
+		t->mipLevels.push_back((Colour*)(data + header.levelOffsets[i]));
+	}
+	t->opaque			= header.opaque != 0;
+	t->contentHash		= header.contentHash;
+	t->contentHashKnown = true;
+	return t;
+}
+
+Texture* Texture::TextureFromFile(const string &filename) {
+	if (filename.size() >= MIP_FILE_EXTENSION.size() &&
+		!filename.compare(filename.size() - MIP_FILE_EXTENSION.size(), MIP_FILE_EXTENSION.size(), MIP_FILE_EXTENSION)) {
+		return TextureFromMipFile(filename);
+	}
+	return TextureFromTGA(filename);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	CONTENT HASH	****************************
+*///////////////////////////////////////////////////////////
+
+uint64_t Texture::GetContentHash() {
+	if (contentHashKnown) {
+		return contentHash;
+	}
+
+	uint64_t hash = 14695981039346656037ull;
+
+	//the texels are hashed row by row, however they're stored, so the same
+	//image hashes the same whichever layout it's in
+	uint sizes[2] = { width, height };
+	for (size_t i = 0; i < sizeof(sizes); ++i) {
+		hash ^= ((const unsigned char*)sizes)[i];
+		hash *= 1099511628211ull;
+	}
+	for (uint y = 0; texels && y < height; ++y) {
+		for (uint x = 0; x < width; ++x) {
+			const unsigned char* bytes = (const unsigned char*)&texels[TexelIndex(x, y, width)];
+			for (size_t i = 0; i < sizeof(Colour); ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		}
+	}
+
+	contentHash			= hash;
+	contentHashKnown	= true;
+	return hash;
+}
+
 const Colour& Texture::NearestTexSample(const Vector3 &coords, int miplevel) {
 	miplevel = min(miplevel, mipLevels.size() - 1);
 	miplevel = (mipLevels.size() - 1) - miplevel;
@@ -57,31 +368,183 @@ const Colour& Texture::NearestTexSample(const Vector3 &coords, int miplevel) {
 }
 
 Colour Texture::BilinearTexSample(const Vector3 &coords, int miplevel) {
-	int texWidth = width;
-	int texHeight = height;
+	return BilinearLevelSample(coords, 0);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	BILINEAR FILTER		************************
+*///////////////////////////////////////////////////////////
+
+//Blends a 2x2 footprint of texels, weighted by fractions of 256 across and
+//down, all four channels at once. Each of the three lerps rounds down, as
+//the float version's did.
+static inline uint BilinearBlend(uint tl, uint tr, uint bl, uint br, int fracX, int fracY) {
+#ifdef TEXTURE_SSE2
+	const __m128i zero	= _mm_setzero_si128();
+	const __m128i one	= _mm_set1_epi16(256);
+
+	//the top row of the footprint in the low four words, the bottom in the high
+	__m128i left	= _mm_unpacklo_epi8(_mm_cvtsi32_si128(tl), zero);
+	__m128i right	= _mm_unpacklo_epi8(_mm_cvtsi32_si128(tr), zero);
+	left	= _mm_unpacklo_epi64(left, _mm_unpacklo_epi8(_mm_cvtsi32_si128(bl), zero));
+	right	= _mm_unpacklo_epi64(right, _mm_unpacklo_epi8(_mm_cvtsi32_si128(br), zero));
+
+	//255 * 256 at most, so the sums never overflow a word
+	__m128i weightX = _mm_set1_epi16((short)fracX);
+	__m128i rows = _mm_srli_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(left, _mm_sub_epi16(one, weightX)),
+		_mm_mullo_epi16(right, weightX)), 8);
+
+	__m128i weightY = _mm_set1_epi16((short)fracY);
+	__m128i result = _mm_srli_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(rows, _mm_sub_epi16(one, weightY)),
+		_mm_mullo_epi16(_mm_srli_si128(rows, 8), weightY)), 8);
+
+	return (uint)_mm_cvtsi128_si32(_mm_packus_epi16(result, zero));
+#else
+	uint out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint top	= ((((tl >> shift) & 0xFF) * (256 - fracX)) + (((tr >> shift) & 0xFF) * fracX)) >> 8;
+		uint bottom	= ((((bl >> shift) & 0xFF) * (256 - fracX)) + (((br >> shift) & 0xFF) * fracX)) >> 8;
+		out |= (((top * (256 - fracY)) + (bottom * fracY)) >> 8) << shift;
+	}
+	return out;
+#endif
+}
+
+static inline int ClampTexel(int v, int size) {
+	return max(0, min(v, size - 1));
+}
 
-	int x = (int)(coords.x * texWidth);
-	int y = (int)(coords.y * texHeight);
+Colour Texture::BilinearLevelSample(const Vector3 &coords, int level) {
+	int texWidth = width >> level;
+	int texHeight = height >> level;
 
-	const Colour &tl = ColourAtPoint(x, y); //our tex point
-	const Colour &tr = ColourAtPoint(x+1, y); //one to right
-	const Colour &bl = ColourAtPoint(x, y+1); //one below
-	const Colour &br = ColourAtPoint(x+1, y+1); //below right
+	float u = coords.x * texWidth;
+	float v = coords.y * texHeight;
 
-	float fracX = (coords.x * texWidth) - x;
-	float fracY = (coords.y * texHeight) - y;
+	int x = (int)u;
+	int y = (int)v;
 
-	Colour top = Colour::Lerp(tl, tr, fracX);
-	Colour bottom = Colour::Lerp(bl, br, fracX);
+	//8 bits of fraction. Coordinates just below 0 round towards it, so come
+	//out negative, but only ever sample the edge texels anyway
+	int fracX = max((int)((u - x) * 256.0f), 0);
+	int fracY = max((int)((v - y) * 256.0f), 0);
 
-	return Colour::Lerp(top, bottom, fracY);
+	int x0 = ClampTexel(x, texWidth);
+	int x1 = ClampTexel(x + 1, texWidth);
+	int y0 = ClampTexel(y, texHeight);
+	int y1 = ClampTexel(y + 1, texHeight);
 
+	const Colour* t = mipLevels[level];
+
+	Colour c;
+	c.c = BilinearBlend(t[TexelIndex(x0, y0, texWidth)].c, t[TexelIndex(x1, y0, texWidth)].c,
+		t[TexelIndex(x0, y1, texWidth)].c, t[TexelIndex(x1, y1, texWidth)].c, fracX, fracY);
+	return c;
+}
+
+#ifdef TEXTURE_SSE2
+//max(0, min(v, hi)) for each lane, without SSE4.1
+static inline __m128i ClampTexelsSSE2(__m128i v, __m128i hi) {
+	v = _mm_and_si128(v, _mm_cmpgt_epi32(v, _mm_setzero_si128()));
+	__m128i over = _mm_cmpgt_epi32(v, hi);
+	return _mm_or_si128(_mm_and_si128(over, hi), _mm_andnot_si128(over, v));
+}
+#endif
+
+void Texture::BilinearTexSampleBatch(const Vector3* coords, uint count, Colour* out) {
+	const int texWidth	= width;
+	const int texHeight = height;
+	const Colour* t		= mipLevels[0];
+
+	uint i = 0;
+#ifdef TEXTURE_SSE2
+	//the footprints of four coordinates are found at once, then fetched and
+	//blended one by one
+	const __m128 sizeX		= _mm_set1_ps((float)texWidth);
+	const __m128 sizeY		= _mm_set1_ps((float)texHeight);
+	const __m128 fraction	= _mm_set1_ps(256.0f);
+	const __m128i lastX		= _mm_set1_epi32(texWidth - 1);
+	const __m128i lastY		= _mm_set1_epi32(texHeight - 1);
+	const __m128i one		= _mm_set1_epi32(1);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 u = _mm_mul_ps(_mm_setr_ps(coords[i].x, coords[i + 1].x, coords[i + 2].x, coords[i + 3].x), sizeX);
+		__m128 v = _mm_mul_ps(_mm_setr_ps(coords[i].y, coords[i + 1].y, coords[i + 2].y, coords[i + 3].y), sizeY);
+
+		__m128i x = _mm_cvttps_epi32(u);
+		__m128i y = _mm_cvttps_epi32(v);
+
+		__m128i fracX = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(u, _mm_cvtepi32_ps(x)), fraction));
+		__m128i fracY = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(v, _mm_cvtepi32_ps(y)), fraction));
+		fracX = _mm_and_si128(fracX, _mm_cmpgt_epi32(fracX, _mm_setzero_si128()));
+		fracY = _mm_and_si128(fracY, _mm_cmpgt_epi32(fracY, _mm_setzero_si128()));
+
+		int x0[4], x1[4], y0[4], y1[4], fx[4], fy[4];
+		_mm_storeu_si128((__m128i*)x0, ClampTexelsSSE2(x, lastX));
+		_mm_storeu_si128((__m128i*)x1, ClampTexelsSSE2(_mm_add_epi32(x, one), lastX));
+		_mm_storeu_si128((__m128i*)y0, ClampTexelsSSE2(y, lastY));
+		_mm_storeu_si128((__m128i*)y1, ClampTexelsSSE2(_mm_add_epi32(y, one), lastY));
+		_mm_storeu_si128((__m128i*)fx, fracX);
+		_mm_storeu_si128((__m128i*)fy, fracY);
+
+		for (int j = 0; j < 4; ++j) {
+			out[i + j].c = BilinearBlend(
+				t[TexelIndex(x0[j], y0[j], texWidth)].c, t[TexelIndex(x1[j], y0[j], texWidth)].c,
+				t[TexelIndex(x0[j], y1[j], texWidth)].c, t[TexelIndex(x1[j], y1[j], texWidth)].c, fx[j], fy[j]);
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		out[i] = BilinearLevelSample(coords[i], 0);
+	}
+}
+
+const Colour& Texture::NearestMipSample(const Vector3 &coords, float lod) {
+	int lastLevel = (int)mipLevels.size() - 1;
+	int level = 0;
+	if (lod > 0.5f) { // also false for a NaN, from a pixel right on the horizon
+		level = (lod >= lastLevel) ? lastLevel : (int)(lod + 0.5f);
+	}
+
+	int texWidth = width >> level;
+	int texHeight = height >> level;
+
+	int x = (int)(coords.x * (texWidth - 1));
+	int y = (int)(coords.y * (texHeight - 1));
+
+	return ColourAtPoint(x, y, level);
+}
+
+Colour Texture::TrilinearTexSample(const Vector3 &coords, float lod) {
+	int lastLevel = (int)mipLevels.size() - 1;
+	if (!(lod > 0.0f)) {
+		return BilinearLevelSample(coords, 0); // magnified
+	}
+	if (lod >= lastLevel) {
+		return BilinearLevelSample(coords, lastLevel);
+	}
+
+	int level = (int)lod;
+	return Colour::Lerp(BilinearLevelSample(coords, level), BilinearLevelSample(coords, level + 1), lod - level);
 }
 
 void Texture::CreateMipMaps() {
+	FreeMipMaps();
+
 	int tempWidth = width;
 	int tempHeight = height;
 
+	//every level is built from this one, so this is the only one to check
+	opaque = true;
+	for (uint i = 0; i < width * height; ++i) {
+		if (texels[i].a != 255) {
+			opaque = false;
+			break;
+		}
+	}
+
 	mipLevels.push_back(texels);
 
 	int numLevels = 0;
@@ -97,8 +560,79 @@ void Texture::CreateMipMaps() {
 
 		mipLevels.push_back(newLevel);
 	}
+
+	if (layout == TEXELS_TILED) {
+		//the levels are built row by row, and rearranged once they're all
+		//done - the full size one too, so it isn't kept both ways
+		for (uint i = 0; i < mipLevels.size(); ++i) {
+			Colour* rows = mipLevels[i];
+			mipLevels[i] = TileLevel(rows, width >> i, height >> i);
+			if (rows != texels) {
+				delete[] rows;
+			}
+			else if (!IsMapped(texels)) {
+				delete[] texels;
+			}
+		}
+		texels = mipLevels[0];
+	}
 }
 
+void Texture::FreeMipMaps() {
+	for (uint i = 0; i < mipLevels.size(); ++i) {
+		if (mipLevels[i] == texels || IsMapped(mipLevels[i])) {
+			continue;
+		}
+		if (layout == TEXELS_TILED) {
+			AlignedFree(mipLevels[i]);
+		}
+		else {
+			delete[] mipLevels[i];
+		}
+	}
+	mipLevels.clear();
+}
+
+size_t Texture::TiledTexelCount(int levelWidth, int levelHeight) {
+	int tilesWide = (levelWidth + TILE_SIZE - 1) >> TILE_BITS;
+	int tilesHigh = (levelHeight + TILE_SIZE - 1) >> TILE_BITS;
+	return (size_t)tilesWide * tilesHigh * TILE_SIZE * TILE_SIZE;
+}
+
+size_t Texture::LevelTexelCount(int level) const {
+	int levelWidth	= width >> level;
+	int levelHeight = height >> level;
+	return (layout == TEXELS_TILED) ? TiledTexelCount(levelWidth, levelHeight) : (size_t)levelWidth * levelHeight;
+}
+
+size_t Texture::GetResidentBytes() const {
+	size_t count = texels ? LevelTexelCount(0) : 0;
+	for (uint i = 0; i < mipLevels.size(); ++i) {
+		if (mipLevels[i] == texels) {
+			continue; // already counted
+		}
+		count += LevelTexelCount(i);
+	}
+	return count * sizeof(Colour);
+}
+
+//Copies a row by row level into tiles, padding the edge tiles out if the
+//level isn't a whole number of them across
+Colour* Texture::TileLevel(const Colour* source, int levelWidth, int levelHeight) {
+	size_t count = TiledTexelCount(levelWidth, levelHeight);
+
+	Colour* tiled = AlignedAlloc(count * sizeof(Colour));
+	for (size_t i = 0; i < count; ++i) {
+		tiled[i] = Colour(0, 0, 0, 0); //the padding's saved and compared too
+	}
+
+	for (int y = 0; y < levelHeight; ++y) {
+		for (int x = 0; x < levelWidth; ++x) {
+			tiled[TiledIndex(x, y, levelWidth)] = source[(y * levelWidth) + x];
+		}
+	}
+	return tiled;
+}
 
 void Texture::GenerateMipLevel(Colour*source, Colour*dest, int level) {
 	int sourceWidth = width >> level;
@@ -116,12 +650,12 @@ void Texture::GenerateMipLevel(Colour*source, Colour*dest, int level) {
 		for (int x = 0; x < sourceWidth; x += 2) {
 			Colour out;
 
-			out += source[(y * sourceHeight) + x] * 0.25f;
-			out += source[(y * sourceHeight) + x+1] * 0.25f;
-			out += source[((y+1) * sourceHeight) + x] * 0.25f;
-			out += source[((y+1) * sourceHeight) + x+1] * 0.25f;
+			out += source[(y * sourceWidth) + x] * 0.25f;
+			out += source[(y * sourceWidth) + x+1] * 0.25f;
+			out += source[((y+1) * sourceWidth) + x] * 0.25f;
+			out += source[((y+1) * sourceWidth) + x+1] * 0.25f;
 		
-			dest[outY * destHeight + outX] = out;
+			dest[outY * destWidth + outX] = out;
 
 			outX++;
 		}
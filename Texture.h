@@ -26,6 +26,9 @@ _-_-_-_-_-_-_-""  ""
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <cstdint>
+
+class MappedFile;
 
 using std::string;
 using std::ifstream;
@@ -34,10 +37,35 @@ using std::vector;
 class Texture	{
 public:
 	friend class SoftwareRasteriser;
+	friend class TextureManager;
 	Texture(void);
 	~Texture(void);
 
 	static Texture* TextureFromTGA(const string &filename);
+
+	//A mip chain baked ahead of time by SaveMipFile (see BakeMips.cpp). The
+	//file is mapped straight into memory, and every level is used where it
+	//lies, so loading one does no reading, copying or filtering at all.
+	static Texture* TextureFromMipFile(const string &filename);
+	bool			SaveMipFile(const string &filename) const;
+
+	//whichever of the two the file's extension says it is
+	static Texture* TextureFromFile(const string &filename);
+
+	//How the texels of every mip level are laid out in memory. LINEAR is row
+	//after row. TILED keeps square patches of texels together, in Z-order,
+	//so a fetch and its neighbours share cache lines and pages whichever
+	//direction the texture is walked across the screen.
+	enum TexelLayout {
+		TEXELS_LINEAR,
+		TEXELS_TILED
+	};
+
+	//Textures are loaded LINEAR, unless baked TILED into a mip file. Working
+	//out where a tiled texel is costs more than the cache misses it saves
+	//for anything measured so far, so it's only ever asked for.
+	void		SetTexelLayout(TexelLayout l);
+	TexelLayout	GetTexelLayout() const { return layout; }
 	
 	const Colour&	NearestTexSample(const Vector3 &coords, int miplevel = 1000);
 
@@ -46,6 +74,15 @@ public:
 
 	// end 11 mod
 
+	//BilinearTexSample for count coordinates at once
+	void	BilinearTexSampleBatch(const Vector3* coords, uint count, Colour* out);
+
+	//lod is log2 of how many texels of the full size texture a pixel covers.
+	//NearestMipSample takes the mip level closest to it, TrilinearTexSample
+	//bilinear samples the two levels either side and blends between them.
+	const Colour&	NearestMipSample(const Vector3 &coords, float lod);
+	Colour			TrilinearTexSample(const Vector3 &coords, float lod);
+
 	const Colour&	ColourAtPoint(int x, int y, int mipLevel = 0) {
 	
 		int texWidth = width >> mipLevel;
@@ -54,20 +91,71 @@ public:
 		x = max(0,min(x,(int)texWidth-1));
 		y = max(0,min(y,(int)texHeight-1));
 
-		int index =  (y * texHeight) + x;
-
-		return mipLevels[mipLevel][index];
+		return mipLevels[mipLevel][TexelIndex(x, y, texWidth)];
 	}
 
 	uint	GetWidth()	{ return width;}
 	uint	GetHeight() { return height;}
 
+	//the memory taken up by the texels and every mip level, mapped or not
+	size_t	GetResidentBytes() const;
+
+	//FNV-1a of the size and full size texels, worked out the first time
+	//it's asked for, unless the mip file it came from already knew it
+	uint64_t	GetContentHash();
+
+	//every texel has an alpha of 255, so drawing with it never needs blending
+	bool	IsOpaque() const { return opaque; }
+
 protected:
+	Colour	BilinearLevelSample(const Vector3 &coords, int level);
+
 	uint width;
 	uint height;
-	Colour* texels;
-	void CreateMipMaps();
+	Colour* texels;	//the full size texture, in the layout below
+	bool	opaque;
+	void CreateMipMaps();	//from texels, which have to be row by row
+	void FreeMipMaps();
+	void FreeTexels();
 	void GenerateMipLevel(Colour*source, Colour*dest, int miplevel);
-	vector<Colour*> mipLevels;
+	vector<Colour*> mipLevels;	//level 0 is texels
+
+	//texels and levels inside the file they were loaded from are read only,
+	//and go when it's unmapped
+	MappedFile*	file;
+	bool		IsMapped(const Colour* p) const;
+
+	size_t		LevelTexelCount(int level) const;
+
+	uint64_t	contentHash;
+	bool		contentHashKnown;
+
+	static const int TILE_BITS = 5;
+	static const int TILE_SIZE = 1 << TILE_BITS;	//32x32 texels, 4KB, a page of memory
+
+	//spreads the bits of a coordinate within a tile out to every other bit
+	static inline int SpreadBits(int v) {
+		v = (v | (v << 4)) & 0x0F0F;
+		v = (v | (v << 2)) & 0x3333;
+		return (v | (v << 1)) & 0x5555;
+	}
+
+	//the tiles are stored row by row, and the texels inside each one in
+	//Z-order, so every aligned 4x4 block of texels is a single cache line
+	static inline int TiledIndex(int x, int y, int levelWidth) {
+		int tilesWide = (levelWidth + TILE_SIZE - 1) >> TILE_BITS;
+		int tile = ((y >> TILE_BITS) * tilesWide) + (x >> TILE_BITS);
+		int inTile = SpreadBits(x & (TILE_SIZE - 1)) | (SpreadBits(y & (TILE_SIZE - 1)) << 1);
+		return (tile << (TILE_BITS * 2)) + inTile;
+	}
+
+	inline int TexelIndex(int x, int y, int levelWidth) const {
+		return (layout == TEXELS_TILED) ? TiledIndex(x, y, levelWidth) : (y * levelWidth) + x;
+	}
+
+	static size_t	TiledTexelCount(int levelWidth, int levelHeight);
+	static Colour*	TileLevel(const Colour* source, int levelWidth, int levelHeight);
+
+	TexelLayout	layout;
 };
 
@@ -0,0 +1,117 @@
+#include "TextureManager.h"
+#include "Texture.h"
+
+#include <cstring>
+
+TextureManager::TextureManager() {
+}
+
+TextureManager::~TextureManager() {
+	for (std::map<Texture*, Entry*>::iterator i = entries.begin(); i != entries.end(); ++i) {
+		delete i->second->texture;
+		delete i->second;
+	}
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	ACQUIRE / RELEASE	************************
+*///////////////////////////////////////////////////////////
+
+Texture* TextureManager::Acquire(const std::string &filename) {
+	std::map<std::string, Entry*>::iterator known = byPath.find(filename);
+	if (known != byPath.end()) {
+		known->second->references++;
+		return known->second->texture;
+	}
+
+	Texture* t = Texture::TextureFromFile(filename);
+
+	//a file that didn't load has no texels to compare, so is kept on its own
+	uint64_t hash = t->texels ? t->GetContentHash() : 0;
+
+	if (t->texels) {
+		std::pair<std::multimap<uint64_t, Entry*>::iterator, std::multimap<uint64_t, Entry*>::iterator> same = byHash.equal_range(hash);
+		for (std::multimap<uint64_t, Entry*>::iterator i = same.first; i != same.second; ++i) {
+			Entry* e = i->second;
+			if (SameTexels(t, e->texture)) {
+				delete t; // already have it, under another name
+				e->references++;
+				e->paths.push_back(filename);
+				byPath[filename] = e;
+				return e->texture;
+			}
+		}
+	}
+
+	Entry* e		= new Entry();
+	e->texture		= t;
+	e->references	= 1;
+	e->hash			= hash;
+	e->paths.push_back(filename);
+
+	entries[t]			= e;
+	byPath[filename]	= e;
+	if (t->texels) {
+		byHash.insert(std::make_pair(hash, e));
+	}
+	return t;
+}
+
+void TextureManager::Release(Texture* t) {
+	std::map<Texture*, Entry*>::iterator i = entries.find(t);
+	if (i == entries.end()) {
+		return; // not one of ours
+	}
+	Entry* e = i->second;
+	if (--e->references == 0) {
+		Remove(e);
+	}
+}
+
+void TextureManager::Remove(Entry* e) {
+	for (uint i = 0; i < e->paths.size(); ++i) {
+		byPath.erase(e->paths[i]);
+	}
+	std::pair<std::multimap<uint64_t, Entry*>::iterator, std::multimap<uint64_t, Entry*>::iterator> same = byHash.equal_range(e->hash);
+	for (std::multimap<uint64_t, Entry*>::iterator i = same.first; i != same.second; ++i) {
+		if (i->second == e) {
+			byHash.erase(i);
+			break;
+		}
+	}
+	entries.erase(e->texture);
+
+	delete e->texture;
+	delete e;
+}
+
+size_t TextureManager::GetResidentBytes() const {
+	size_t total = 0;
+	for (std::map<Texture*, Entry*>::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+		total += i->first->GetResidentBytes();
+	}
+	return total;
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	SAME TEXELS	****************************
+*///////////////////////////////////////////////////////////
+
+//two different images can hash the same, so a match is only trusted once
+//the texels themselves agree
+bool TextureManager::SameTexels(const Texture* a, const Texture* b) {
+	if (a->width != b->width || a->height != b->height || !a->texels || !b->texels) {
+		return false;
+	}
+	if (a->layout == b->layout) {
+		return memcmp(a->texels, b->texels, a->LevelTexelCount(0) * sizeof(Colour)) == 0;
+	}
+	for (uint y = 0; y < a->height; ++y) {
+		for (uint x = 0; x < a->width; ++x) {
+			if (a->texels[a->TexelIndex(x, y, a->width)].c != b->texels[b->TexelIndex(x, y, b->width)].c) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+Class:TextureManager
+Implements:
+Author:Geoff Whitehead
+Description:Hands out textures loaded from disk, so every object drawn with
+the same image shares one copy of it, and one mip chain. Textures are looked
+up first by the path they were asked for with, and then, once loaded, by a
+hash of their texels, so the same image saved under two names is still only
+kept once.
+
+Every Acquire must be matched by a Release - the texture is deleted when the
+last one is released. Anything still held when the manager is destroyed is
+deleted along with it.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Common.h"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+
+class Texture;
+
+class TextureManager {
+public:
+	TextureManager();
+	~TextureManager();
+
+	Texture*	Acquire(const std::string &filename);
+	void		Release(Texture* t);
+
+	//how many distinct textures are loaded, and the memory their texels
+	//and mip levels take up between them
+	uint		GetTextureCount() const { return (uint)entries.size(); }
+	size_t		GetResidentBytes() const;
+
+protected:
+	struct Entry {
+		Texture*					texture;
+		uint						references;
+		uint64_t					hash;
+		std::vector<std::string>	paths;	//every path it's been asked for with
+	};
+
+	static bool		SameTexels(const Texture* a, const Texture* b);
+
+	void			Remove(Entry* e);
+
+	std::map<Texture*, Entry*>				entries;
+	std::map<std::string, Entry*>			byPath;
+	std::multimap<uint64_t, Entry*>			byHash;
+};
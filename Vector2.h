@@ -11,6 +11,7 @@ _-_-_-_-_-_-_-""  ""
 
 *//////////////////////////////////////////////////////////////////////////////
 #pragma once
+#include <cmath>
 #include <iostream>
 
 class Vector2	{
@@ -0,0 +1,142 @@
+#include "VertexTransform.h"
+
+#ifdef VERTEX_TRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+
+/*//////////////////////////////////////////////////////////
+//**********	TRANSFORM SELECTION	************************
+*///////////////////////////////////////////////////////////
+
+bool VertexTransform::IsSupported(Type type) {
+	switch (type) {
+	case TRANSFORM_SCALAR:
+		return true;
+#ifdef VERTEX_TRANSFORM_SSE2
+	case TRANSFORM_SSE2:
+		return CPUFeatures::HasSSE2();
+#endif
+#ifdef VERTEX_TRANSFORM_AVX2
+	case TRANSFORM_AVX2:
+		return CPUFeatures::HasAVX2();
+#endif
+	default:
+		return false;
+	}
+}
+
+VertexTransform VertexTransform::Create(Type type) {
+	VertexTransform t;
+	t.type	= TRANSFORM_SCALAR;
+	t.name	= "scalar";
+	t.func	= VertexTransformScalar;
+
+	if (!IsSupported(type)) {
+		return t;
+	}
+#ifdef VERTEX_TRANSFORM_SSE2
+	if (type == TRANSFORM_SSE2) {
+		t.type	= TRANSFORM_SSE2;
+		t.name	= "sse2";
+		t.func	= VertexTransformSSE2;
+	}
+#endif
+#ifdef VERTEX_TRANSFORM_AVX2
+	if (type == TRANSFORM_AVX2) {
+		t.type	= TRANSFORM_AVX2;
+		t.name	= "avx2";
+		t.func	= VertexTransformAVX2;
+	}
+#endif
+	return t;
+}
+
+VertexTransform VertexTransform::CreateBest() {
+	const Type best[] = { TRANSFORM_AVX2, TRANSFORM_SSE2 };
+
+	for (int i = 0; i < 2; ++i) {
+		if (IsSupported(best[i])) {
+			return Create(best[i]);
+		}
+	}
+	return Create(TRANSFORM_SCALAR);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	SCALAR TRANSFORM	************************
+*///////////////////////////////////////////////////////////
+
+void VertexTransform::TransformScalar(const Matrix4 &m, const Vector4* in, uint first, uint last, ClipSpaceBuffer &out) {
+	for (uint i = first; i < last; ++i) {
+		Vector4 v = m * in[i];
+
+		out.x[i]		= v.x;
+		out.y[i]		= v.y;
+		out.z[i]		= v.z;
+		out.w[i]		= v.w;
+		out.outcodes[i] = Outcode(v.x, v.y, v.z, v.w);
+	}
+}
+
+void VertexTransformScalar(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out) {
+	VertexTransform::TransformScalar(m, in, 0, count, out);
+}
+
+/*//////////////////////////////////////////////////////////
+//**********	SSE2 TRANSFORM	****************************
+*///////////////////////////////////////////////////////////
+
+#ifdef VERTEX_TRANSFORM_SSE2
+
+//one axis of VertexTransform::Outcode, for 4 vertices
+static inline __m128i AxisOutcodesSSE2(__m128 v, __m128 w, __m128 minusW, int below, int above) {
+	__m128 under	= _mm_cmplt_ps(v, minusW);
+	__m128 over		= _mm_andnot_ps(under, _mm_cmpgt_ps(v, w));
+
+	return _mm_or_si128(
+		_mm_and_si128(_mm_castps_si128(under), _mm_set1_epi32(below)),
+		_mm_and_si128(_mm_castps_si128(over), _mm_set1_epi32(above)));
+}
+
+void VertexTransformSSE2(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out) {
+	__m128 cols[16];
+	for (int i = 0; i < 16; ++i) {
+		cols[i] = _mm_set1_ps(m.values[i]);
+	}
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	uint i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(in[i].array);
+		__m128 vy = _mm_loadu_ps(in[i + 1].array);
+		__m128 vz = _mm_loadu_ps(in[i + 2].array);
+		__m128 vw = _mm_loadu_ps(in[i + 3].array);
+		_MM_TRANSPOSE4_PS(vx, vy, vz, vw);
+
+		//added up in the same order as Matrix4 * Vector4, so the results match
+		__m128 result[4];
+		for (int row = 0; row < 4; ++row) {
+			__m128 r = _mm_mul_ps(vx, cols[row]);
+			r = _mm_add_ps(r, _mm_mul_ps(vy, cols[row + 4]));
+			r = _mm_add_ps(r, _mm_mul_ps(vz, cols[row + 8]));
+			r = _mm_add_ps(r, _mm_mul_ps(vw, cols[row + 12]));
+			result[row] = r;
+		}
+
+		_mm_storeu_ps(&out.x[i], result[0]);
+		_mm_storeu_ps(&out.y[i], result[1]);
+		_mm_storeu_ps(&out.z[i], result[2]);
+		_mm_storeu_ps(&out.w[i], result[3]);
+
+		__m128 minusW = _mm_xor_ps(result[3], signBit);
+
+		__m128i codes = AxisOutcodesSSE2(result[0], result[3], minusW, LEFT_CS, RIGHT_CS);
+		codes = _mm_or_si128(codes, AxisOutcodesSSE2(result[1], result[3], minusW, BOTTOM_CS, TOP_CS));
+		codes = _mm_or_si128(codes, AxisOutcodesSSE2(result[2], result[3], minusW, NEAR_CS, FAR_CS));
+
+		_mm_storeu_si128((__m128i*)&out.outcodes[i], codes);
+	}
+	VertexTransform::TransformScalar(m, in, i, count, out);
+}
+
+#endif
@@ -0,0 +1,133 @@
+/******************************************************************************
+Class:VertexTransform
+Implements:
+Author:Geoff Whitehead
+Description:The vertex stage. Transforms every position of a mesh into clip
+space in one pass, and works out each one's outcode (which of the clip
+planes it is outside of) while it is there, leaving the results in a
+ClipSpaceBuffer with an array per component. The primitive assembly code
+reads its vertices back out of that, so nothing is transformed twice.
+
+The SIMD versions transform 4 or 8 vertices at a time, and give exactly the
+same results as Matrix4 * Vector4. The best one the CPU supports is picked
+at runtime, like the pixel kernels.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CPUFeatures.h"
+#include "Matrix4.h"
+#include "Vector4.h"
+#include "Common.h"
+
+#include <vector>
+
+#ifdef SR_X86
+#define VERTEX_TRANSFORM_SSE2
+//see PixelKernel.h - CMakeLists.txt builds the AVX2 file with the right flags
+#if defined(_MSC_VER) || defined(SR_ENABLE_AVX2)
+#define VERTEX_TRANSFORM_AVX2
+#endif
+#endif
+
+// OUTCODE CONSTANTS
+const int INSIDE_CS = 0;	//000000
+const int LEFT_CS = 1;	//000001
+const int RIGHT_CS = 2;	//000010
+const int BOTTOM_CS = 4;	//000100
+const int TOP_CS = 8;	//001000
+const int NEAR_CS = 16;	//010000
+const int FAR_CS = 32;	//100000
+const int ALL_CS = 63;	//111111
+
+struct ClipSpaceBuffer {
+	std::vector<float>	x;
+	std::vector<float>	y;
+	std::vector<float>	z;
+	std::vector<float>	w;
+	std::vector<int>	outcodes;
+	uint				count;
+
+	ClipSpaceBuffer() {
+		count = 0;
+	}
+
+	//never shrinks, so a buffer reused for every draw soon stops allocating
+	void Resize(uint n) {
+		count = n;
+		if (x.size() < n) {
+			x.resize(n);
+			y.resize(n);
+			z.resize(n);
+			w.resize(n);
+			outcodes.resize(n);
+		}
+	}
+
+	Vector4 Position(uint i) const {
+		return Vector4(x[i], y[i], z[i], w[i]);
+	}
+};
+
+//in holds count positions, and out has been resized to fit them
+typedef void (*VertexTransformFunc)(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out);
+
+class VertexTransform {
+public:
+	enum Type {
+		TRANSFORM_SCALAR,
+		TRANSFORM_SSE2,
+		TRANSFORM_AVX2
+	};
+
+	static bool				IsSupported(Type type);
+	static VertexTransform	Create(Type type);
+	static VertexTransform	CreateBest();
+
+	//the same tests as SoftwareRasteriser::HomogenousOutcode
+	static inline int Outcode(float x, float y, float z, float w) {
+		int outCode = INSIDE_CS;
+
+		if (x < -w) {
+			outCode |= LEFT_CS;
+		}
+		else if (x > w) {
+			outCode |= RIGHT_CS;
+		}
+		if (y < -w) {
+			outCode |= BOTTOM_CS;
+		}
+		else if (y > w) {
+			outCode |= TOP_CS;
+		}
+		if (z < -w) {
+			outCode |= NEAR_CS;
+		}
+		else if (z > w) {
+			outCode |= FAR_CS;
+		}
+		return outCode;
+	}
+
+	//transforms and outcodes in[first] to in[last - 1] one at a time. The
+	//SIMD versions use it for whatever is left over at the end.
+	static void TransformScalar(const Matrix4 &m, const Vector4* in, uint first, uint last, ClipSpaceBuffer &out);
+
+	void Transform(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out) const {
+		out.Resize(count);
+		func(m, in, count, out);
+	}
+
+	Type				type;
+	const char*			name;
+	VertexTransformFunc	func;
+};
+
+void VertexTransformScalar(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out);
+#ifdef VERTEX_TRANSFORM_SSE2
+void VertexTransformSSE2(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out);
+#endif
+#ifdef VERTEX_TRANSFORM_AVX2
+void VertexTransformAVX2(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out);
+#endif
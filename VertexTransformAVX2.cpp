@@ -0,0 +1,77 @@
+#include "VertexTransform.h"
+
+/*
+Kept in a file of its own for the same reasons as the AVX2 pixel kernel.
+*/
+
+#ifdef VERTEX_TRANSFORM_AVX2
+
+#include <immintrin.h>
+
+/*//////////////////////////////////////////////////////////
+//**********	AVX2 TRANSFORM	****************************
+*///////////////////////////////////////////////////////////
+
+//one axis of VertexTransform::Outcode, for 8 vertices
+static inline __m256i AxisOutcodesAVX2(__m256 v, __m256 w, __m256 minusW, int below, int above) {
+	__m256 under	= _mm256_cmp_ps(v, minusW, _CMP_LT_OQ);
+	__m256 over		= _mm256_andnot_ps(under, _mm256_cmp_ps(v, w, _CMP_GT_OQ));
+
+	return _mm256_or_si256(
+		_mm256_and_si256(_mm256_castps_si256(under), _mm256_set1_epi32(below)),
+		_mm256_and_si256(_mm256_castps_si256(over), _mm256_set1_epi32(above)));
+}
+
+void VertexTransformAVX2(const Matrix4 &m, const Vector4* in, uint count, ClipSpaceBuffer &out) {
+	__m256 cols[16];
+	for (int i = 0; i < 16; ++i) {
+		cols[i] = _mm256_set1_ps(m.values[i]);
+	}
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+	uint i = 0;
+	for (; i + 8 <= count; i += 8) {
+		//vertex n in the low half and n + 4 in the high half, so the
+		//transpose within each half leaves every component in order
+		__m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in[i].array)), _mm_loadu_ps(in[i + 4].array), 1);
+		__m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in[i + 1].array)), _mm_loadu_ps(in[i + 5].array), 1);
+		__m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in[i + 2].array)), _mm_loadu_ps(in[i + 6].array), 1);
+		__m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in[i + 3].array)), _mm_loadu_ps(in[i + 7].array), 1);
+
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+		__m256 vx = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 vy = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 vz = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 vw = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+		//added up in the same order as Matrix4 * Vector4, so the results match
+		__m256 result[4];
+		for (int row = 0; row < 4; ++row) {
+			__m256 r = _mm256_mul_ps(vx, cols[row]);
+			r = _mm256_add_ps(r, _mm256_mul_ps(vy, cols[row + 4]));
+			r = _mm256_add_ps(r, _mm256_mul_ps(vz, cols[row + 8]));
+			r = _mm256_add_ps(r, _mm256_mul_ps(vw, cols[row + 12]));
+			result[row] = r;
+		}
+
+		_mm256_storeu_ps(&out.x[i], result[0]);
+		_mm256_storeu_ps(&out.y[i], result[1]);
+		_mm256_storeu_ps(&out.z[i], result[2]);
+		_mm256_storeu_ps(&out.w[i], result[3]);
+
+		__m256 minusW = _mm256_xor_ps(result[3], signBit);
+
+		__m256i codes = AxisOutcodesAVX2(result[0], result[3], minusW, LEFT_CS, RIGHT_CS);
+		codes = _mm256_or_si256(codes, AxisOutcodesAVX2(result[1], result[3], minusW, BOTTOM_CS, TOP_CS));
+		codes = _mm256_or_si256(codes, AxisOutcodesAVX2(result[2], result[3], minusW, NEAR_CS, FAR_CS));
+
+		_mm256_storeu_si256((__m256i*)&out.outcodes[i], codes);
+	}
+	VertexTransform::TransformScalar(m, in, i, count, out);
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "Window.h"
 
+#ifdef WINDOW_WIN32
+
 Window::Window(uint width, uint height)	{
 	hasInit = false;
 	HINSTANCE hInstance = GetModuleHandle( NULL );
@@ -94,6 +96,9 @@ void Window::PresentBuffer(Colour*buffer) {
 			memcpy(bufferData[1], buffer, screenWidth * screenHeight * sizeof(unsigned int));
 		}
 	}
+	if (frameCallback) {
+		frameCallback(buffer, screenWidth, screenHeight);
+	}
 	BitBlt(deviceContext, 0, 0, screenWidth, screenHeight, drawDC, 0, 0, SRCCOPY);
 }
 
@@ -206,4 +211,6 @@ void Window::CheckMessages(MSG &msg)	{
 			DispatchMessage(&msg);				// Dispatch The Message
 		}
 	}
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
+#include <functional>
+
 #include "Common.h"
 #include "Colour.h"
 
 #include "Mouse.h"
 #include "Keyboard.h"
 
-
+#ifdef WINDOW_WIN32
 #include <windows.h>
 #include <fcntl.h>
 
@@ -14,8 +16,11 @@
 #define VC_EXTRALEAN
 
 #define WINDOWCLASS "WindowClass"
+#endif
 
-//This is the OS-specific crap required to render our pixel blocks on screen
+//This is the OS-specific crap required to render our pixel blocks on screen.
+//Window.cpp does it with Win32, WindowHeadless.cpp just keeps the pixels in
+//memory, for rendering where there is no screen at all.
 class Window	{
 public:
 	Window(uint width, uint height);
@@ -23,10 +28,28 @@ public:
 
 	void PresentBuffer(Colour*buffer);
 
-	bool	UpdateWindow();	
+	bool	UpdateWindow();
+
+	//Called by PresentBuffer with every finished frame, before it goes to the
+	//screen (if there is one). The pixels are only valid during the call.
+	typedef std::function<void(const Colour* pixels, uint width, uint height)> FrameCallback;
+
+	void	SetFrameCallback(const FrameCallback &callback) {
+		frameCallback = callback;
+	}
+
+	//Makes the next UpdateWindow return false
+	void	Close() {
+		forceQuit = true;
+	}
+
+	uint	GetScreenWidth() const	{ return screenWidth; }
+	uint	GetScreenHeight() const	{ return screenHeight; }
 
 protected:
+#ifdef WINDOW_WIN32
 	void CheckMessages(MSG &msg);
+#endif
 
 	void BuildBitmap();
 
@@ -34,6 +57,7 @@ protected:
 
 	};
 
+#ifdef WINDOW_WIN32
 	//Windows requires a static callback function to handle certain incoming messages.
 	static LRESULT CALLBACK StaticWindowProc(HWND hWnd,UINT message,WPARAM wParam,LPARAM lParam);
 
@@ -41,17 +65,23 @@ protected:
 
 	HWND	windowHandle;	//OS handle
 	HDC		deviceContext;
+#endif
 
 	uint	screenWidth;
 	uint	screenHeight;
 
-
+#ifdef WINDOW_WIN32
 	HDC		drawDC;
 
 	HBITMAP bitBuffers[2];
+#endif
 	void *bufferData[2];
 
-	VOID *pvBits;          // pointer to DIB section 
+#ifdef WINDOW_WIN32
+	VOID *pvBits;          // pointer to DIB section
+#endif
+
+	FrameCallback	frameCallback;
 
 	bool	forceQuit;
 	bool	hasInit;
@@ -0,0 +1,64 @@
+#include "Window.h"
+
+#ifdef WINDOW_HEADLESS
+
+#include <cstring>
+
+/*
+There's no screen to draw to here, so the window owns both of its colour
+buffers itself, laid out just like the Win32 DIB sections (bottom row first,
+one 32 bit Colour per pixel). Rasterisers using the OS buffers draw straight
+into them, and finished frames only ever leave through the frame callback.
+*/
+Window::Window(uint width, uint height)	{
+	hasInit		= false;
+
+	screenWidth		= width;
+	screenHeight	= height;
+
+	bufferData[0] = NULL;
+	bufferData[1] = NULL;
+
+	BuildBitmap();
+
+	Keyboard::Initialise();
+	Mouse::Initialise();
+
+	hasInit		= true;
+	forceQuit	= false;
+}
+
+Window::~Window(void)	{
+	delete[] (Colour*)bufferData[0];
+	delete[] (Colour*)bufferData[1];
+
+	Keyboard::Destroy();
+	Mouse::Destroy();
+}
+
+void Window::BuildBitmap() {
+	delete[] (Colour*)bufferData[0];
+	delete[] (Colour*)bufferData[1];
+
+	for (int i = 0; i < 2; ++i) {
+		bufferData[i] = new Colour[screenWidth * screenHeight];
+		memset(bufferData[i], 0, screenWidth * screenHeight * sizeof(Colour));
+	}
+}
+
+void Window::PresentBuffer(Colour*buffer) {
+	//Unlike the Win32 version, there's no need to copy a buffer that isn't
+	//ours anywhere, as the callback can just as easily read it where it is
+	if (frameCallback) {
+		frameCallback(buffer, screenWidth, screenHeight);
+	}
+}
+
+bool	Window::UpdateWindow() {
+	Keyboard::instance->UpdateHolds();
+	Mouse::instance->UpdateHolds();
+
+	return !forceQuit;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(uint threadCount) {
+	job			= NULL;
+	jobCount	= 0;
+	nextJob		= 0;
+	generation	= 0;
+	busyWorkers = 0;
+	quit		= false;
+
+	for (uint i = 1; i < threadCount; ++i) {
+		threads.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+}
+
+WorkerPool::~WorkerPool(void) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wakeWorkers.notify_all();
+
+	for (uint i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+}
+
+uint WorkerPool::DefaultThreadCount() {
+	uint count = std::thread::hardware_concurrency();
+	return count ? count : 1;
+}
+
+void WorkerPool::Run(uint count, const std::function<void(uint)> &newJob) {
+	if (threads.empty()) {
+		for (uint i = 0; i < count; ++i) {
+			newJob(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job			= &newJob;
+		jobCount	= count;
+		nextJob		= 0;
+		busyWorkers = (uint)threads.size();
+		generation++;
+	}
+	wakeWorkers.notify_all();
+
+	DoJobs();
+
+	//the batch isn't done until the workers have all stopped touching it
+	std::unique_lock<std::mutex> lock(mutex);
+	workersDone.wait(lock, [this] { return busyWorkers == 0; });
+	job = NULL;
+}
+
+void WorkerPool::WorkerLoop() {
+	uint seenGeneration = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeWorkers.wait(lock, [&] { return quit || generation != seenGeneration; });
+			if (quit) {
+				return;
+			}
+			seenGeneration = generation;
+		}
+
+		DoJobs();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyWorkers == 0) {
+			workersDone.notify_one();
+		}
+	}
+}
+
+void WorkerPool::DoJobs() {
+	uint i;
+	while ((i = nextJob++) < jobCount) {
+		(*job)(i);
+	}
+}
@@ -0,0 +1,51 @@
+/******************************************************************************
+Class:WorkerPool
+Implements:
+Author:Geoff Whitehead
+Description:A fixed set of threads that can be handed a batch of numbered
+jobs to share out between them. The thread calling Run joins in with the
+work, and Run doesn't return until every job in the batch has finished.
+
+*//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "Common.h"
+
+class WorkerPool {
+public:
+	//threadCount includes the calling thread, so 1 means no extra threads
+	WorkerPool(uint threadCount);
+	~WorkerPool(void);
+
+	void	Run(uint jobCount, const std::function<void(uint)> &job);
+
+	uint	GetThreadCount() const { return (uint)threads.size() + 1; }
+
+	static uint DefaultThreadCount();
+
+protected:
+	void	WorkerLoop();
+	void	DoJobs();
+
+	std::vector<std::thread>	threads;
+
+	std::mutex					mutex;
+	std::condition_variable		wakeWorkers;
+	std::condition_variable		workersDone;
+
+	const std::function<void(uint)>* job;
+	uint						jobCount;
+	std::atomic<uint>			nextJob;
+
+	uint						generation;	//bumped for every batch
+	uint						busyWorkers;
+	bool						quit;
+};
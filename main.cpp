@@ -2,9 +2,12 @@
 
 #include "Mesh.h"
 #include "Texture.h"
+#include "TextureManager.h"
 #include <vector>
 #include <cstdlib>
-#include <ctime>.
+#include <ctime>
+#include <chrono>
+#include <iostream>
 
 #define RED_SUN 1
 #define BLUE_SUN 2
@@ -57,6 +60,18 @@ int main() {
 	SoftwareRasteriser r(SCREEN_WIDTH, SCREEN_HEIGHT); // make window canvas to draw in
 	srand(static_cast <unsigned> (time(0))); // seed the generator 
 
+#ifdef WINDOW_HEADLESS
+	// no screen or keyboard, so render a set number of frames and say how long they took
+	const int HEADLESS_FRAMES = 300;
+	int frameCount = 0;
+	r.SetFrameCallback([&](const Colour* pixels, uint width, uint height) {
+		if (++frameCount == HEADLESS_FRAMES) {
+			r.Close();
+		}
+	});
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+#endif
+
 
 	/*//////////////////////////////////////////////////////////
 	//**********	GENERATE STARS	****************************
@@ -145,7 +160,7 @@ int main() {
 	//**********	CREATE SPACESHIP	************************
 	*///////////////////////////////////////////////////////////
 	// create the ship mesh/renderobject
-	Mesh* ship_mesh = Mesh::LoadMeshFile("spaceship.mesh");
+	Mesh* ship_mesh = Mesh::LoadMeshFile("spaceship.mesh", true); // welded, so shared vertices are only transformed once
 	RenderObject * ship = new RenderObject();
 	ship->mesh = ship_mesh;
 
@@ -154,17 +169,22 @@ int main() {
 	*///////////////////////////////////////////////////////////
 	Mesh *comet = Mesh::GenerateRock();
 
+	//the comets all share one copy of their texture
+	TextureManager textures;
+
 	RenderObject * c1 = new RenderObject();
 	c1->mesh = comet;
-	c1->texture = Texture::TextureFromTGA("snow_2_m_gold.tga");
+	c1->texture = textures.Acquire("snow_2_m_gold.tga");
 
 	RenderObject * c2 = new RenderObject();
 	c2->mesh = comet;
-	c2->texture = Texture::TextureFromTGA("snow_2_m_gold.tga");
+	c2->texture = textures.Acquire("snow_2_m_gold.tga");
 
 	RenderObject * c3 = new RenderObject();
 	c3->mesh = comet;
-	c3->texture = Texture::TextureFromTGA("snow_2_m_gold.tga");
+	c3->texture = textures.Acquire("snow_2_m_gold.tga");
+
+	std::cout << textures.GetTextureCount() << " texture(s) loaded, " << (textures.GetResidentBytes() >> 10) << "KB" << std::endl;
 
 	/*//////////////////////////////////////////////////////////
 	//**********	CREATE DEBRIS	****************************
@@ -248,6 +268,26 @@ int main() {
 		if (Keyboard::KeyTriggered(KEY_R)) {
 			r.SwitchTextureFiltering();
 		}
+		if (Keyboard::KeyTriggered(KEY_T)) {
+			r.SwitchRasteriseMode(); // flip between the area and edge function triangle fill
+		}
+		if (Keyboard::KeyTriggered(KEY_B)) {
+			r.SwitchBinning(); // fill the screen a tile at a time across all the cores
+		}
+		if (Keyboard::KeyTriggered(KEY_H)) {
+			r.SwitchHiZ(); // skip blocks hidden behind what's already been drawn
+		}
+		if (Keyboard::KeyTriggered(KEY_G)) {
+			r.SwitchGuardBand(); // leave the edges of the screen to the rasteriser instead of the clipper
+		}
+		if (Keyboard::KeyTriggered(KEY_P)) {
+			if (r.IsTracing()) {
+				r.StopTrace("trace.json"); // open in chrome://tracing to see where the frames went
+			}
+			else {
+				r.StartTrace();
+			}
+		}
 		
 
 		// clear buffers BEFORE drawing *********
@@ -274,12 +314,20 @@ int main() {
 		r.SwapBuffers();
 	}
 
+#ifdef WINDOW_HEADLESS
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	std::cout << frameCount << " frames, " << (elapsed.count() / frameCount) << " ms/frame" << std::endl;
+#endif
+
 	// *************** DELETES ******************
 
 	delete starmap;
 	delete sun;
 	delete c;
 	delete ship;
+	textures.Release(c1->texture);
+	textures.Release(c2->texture);
+	textures.Release(c3->texture);
 	delete c1;
 	delete c2;
 	delete c3;